@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "bench-utils.h"
+
+#define QUERIES		4096
+
+static size_t counts[] = {16, 128, 512, 4096, 32768};
+
+static void bench(size_t count)
+{
+	size_t *size = os_malloc(count * sizeof(*size));
+	unsigned char *status = os_malloc(count);
+	block_meta **blocks = os_malloc(count * sizeof(*blocks));
+	size_t *req = os_malloc(QUERIES * sizeof(*req));
+	size_t span = 0;
+
+	/* Lay the blocks out like a heap, each header followed by its payload */
+	srand(count);
+	for (size_t i = 0; i < count; i++) {
+		size[i] = ALIGN(sizeof(block_meta)) + ALIGN(16 + rand() % 4000);
+		status[i] = rand() % 3 ? STATUS_ALLOC : STATUS_FREE;
+		span += size[i];
+	}
+	char *heap = os_malloc(span);
+
+	for (size_t i = 0, offset = 0; i < count; offset += size[i], i++) {
+		blocks[i] = (block_meta *)(heap + offset);
+		blocks[i]->size = size[i];
+		blocks[i]->status = status[i];
+		blocks[i]->next = i + 1 < count ? (block_meta *)(heap + offset + size[i]) : NULL;
+	}
+	for (size_t q = 0; q < QUERIES; q++)
+		req[q] = ALIGN(sizeof(block_meta)) + ALIGN(1 + rand() % 4200);
+
+	uint64_t start = now_ns();
+
+	for (size_t q = 0; q < QUERIES; q++)
+		consume(list_best_fit(blocks[0], req[q]));
+	uint64_t list = now_ns() - start;
+
+	start = now_ns();
+	for (size_t q = 0; q < QUERIES; q++)
+		consume((void *)fit_scan_generic(size, status, count, req[q]));
+	uint64_t scalar = now_ns() - start;
+
+	start = now_ns();
+	for (size_t q = 0; q < QUERIES; q++)
+		consume((void *)fit_scan(size, status, count, req[q]));
+	uint64_t simd = now_ns() - start;
+
+	for (size_t q = 0; q < QUERIES; q++) {
+		block_meta *expected = list_best_fit(blocks[0], req[q]);
+		size_t found = fit_scan(size, status, count, req[q]);
+
+		if ((found == count ? NULL : blocks[found]) != expected) {
+			printf("mismatch for %zu blocks, size %zu\n", count, req[q]);
+			exit(1);
+		}
+	}
+
+	printf("%6zu blocks   list %9.1f ns   scalar table %9.1f ns   %s table %9.1f ns\n",
+	       count, (double)list / QUERIES, (double)scalar / QUERIES, fit_kernels_name(),
+	       (double)simd / QUERIES);
+
+	os_free(heap);
+	os_free(req);
+	os_free(blocks);
+	os_free(status);
+	os_free(size);
+}
+
+int main(void)
+{
+	fit_kernels_init();
+	for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++)
+		bench(counts[i]);
+	return 0;
+}
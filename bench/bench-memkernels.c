@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "bench-utils.h"
+
+#define WORKING_SET	(256 * MULT_KB)
+#define ROUNDS		8
+
+static size_t sizes[] = {4 * MULT_KB, 64 * MULT_KB, 512 * MULT_KB, 2 * MULT_MB, 16 * MULT_MB, 64 * MULT_MB};
+
+/* Sum the working set, the time it takes shows how much of it got evicted */
+static uint64_t touch(volatile char *ws)
+{
+	uint64_t start = now_ns();
+
+	for (size_t i = 0; i < WORKING_SET; i += 64)
+		ws[i]++;
+	return now_ns() - start;
+}
+
+static void bench_copy(char *ws, char *dst, char *src, size_t size)
+{
+	uint64_t libc = 0, kern = 0, libc_ws = 0, kern_ws = 0;
+
+	for (int r = 0; r < ROUNDS; r++) {
+		touch(ws);
+		uint64_t start = now_ns();
+
+		memcpy(dst, src, size);
+		libc += now_ns() - start;
+		consume(dst);
+		libc_ws += touch(ws);
+
+		touch(ws);
+		start = now_ns();
+		mem_copy(dst, src, size);
+		kern += now_ns() - start;
+		consume(dst);
+		kern_ws += touch(ws);
+	}
+	printf("copy %8zu KiB   libc %8.3f GB/s ws %6lu ns   kernel %8.3f GB/s ws %6lu ns\n",
+	       size / MULT_KB, (double)size * ROUNDS / libc, libc_ws / ROUNDS,
+	       (double)size * ROUNDS / kern, kern_ws / ROUNDS);
+}
+
+static void bench_zero(char *ws, char *dst, size_t size)
+{
+	uint64_t libc = 0, kern = 0, libc_ws = 0, kern_ws = 0;
+
+	for (int r = 0; r < ROUNDS; r++) {
+		touch(ws);
+		uint64_t start = now_ns();
+
+		memset(dst, 0, size);
+		libc += now_ns() - start;
+		consume(dst);
+		libc_ws += touch(ws);
+
+		touch(ws);
+		start = now_ns();
+		mem_zero(dst, size);
+		kern += now_ns() - start;
+		consume(dst);
+		kern_ws += touch(ws);
+	}
+	printf("zero %8zu KiB   libc %8.3f GB/s ws %6lu ns   kernel %8.3f GB/s ws %6lu ns\n",
+	       size / MULT_KB, (double)size * ROUNDS / libc, libc_ws / ROUNDS,
+	       (double)size * ROUNDS / kern, kern_ws / ROUNDS);
+}
+
+int main(void)
+{
+	size_t max = sizes[sizeof(sizes) / sizeof(sizes[0]) - 1];
+	char *ws = os_malloc(WORKING_SET);
+	char *src = os_malloc(max);
+	char *dst = os_malloc(max);
+
+	memset(ws, 1, WORKING_SET);
+	memset(src, 2, max);
+	memset(dst, 3, max);
+	mem_kernels_init();
+	printf("kernels: %s, non-temporal above %d KiB\n", mem_kernels_name(), MEM_NT_THRESHOLD / MULT_KB);
+
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+		bench_copy(ws, dst, src, sizes[i]);
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+		bench_zero(ws, dst, sizes[i]);
+
+	os_free(dst);
+	os_free(src);
+	os_free(ws);
+	return 0;
+}
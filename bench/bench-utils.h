@@ -0,0 +1,25 @@
+/* SPDX-License-Identifier: BSD-3-Clause */
+
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+#include "osmem.h"
+#include "helpers.h"
+
+#define MULT_KB		1024
+#define MULT_MB		(1024 * 1024)
+
+static inline uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* Keep the compiler from dropping a result */
+static inline void consume(const void *ptr)
+{
+	__asm__ volatile("" : : "r"(ptr) : "memory");
+}
@@ -0,0 +1,159 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "osmem.h"
+#include "helpers.h"
+
+/*An arena bumps through a chain of mapped chunks. Its blocks carry a
+regular header with STATUS_ARENA, so the rest of the allocator recognises
+them, and only go away when the arena is reset or destroyed*/
+typedef struct arena_chunk {
+	struct arena_chunk *next;
+	size_t length;
+	size_t used;
+} arena_chunk;
+
+struct os_arena {
+	arena_chunk *chunks;
+};
+
+/* Arenas pushed on this thread, the last one gets os_malloc and os_calloc */
+static __thread os_arena *arena_stack[ARENA_STACK_DEPTH];
+static __thread int arena_depth;
+
+
+static arena_chunk *add_chunk(os_arena *arena, size_t size)
+{
+	size_t page_size = sysconf(_SC_PAGESIZE);
+	size_t length = ALIGN(sizeof(arena_chunk)) + size;
+	length = length > ARENA_CHUNK_SIZE ? (length + page_size - 1) & ~(page_size - 1) : ARENA_CHUNK_SIZE;
+
+	arena_chunk *chunk = map_pages(length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	DIE(chunk == MAP_FAILED, "mmap");
+	chunk->length = length;
+	chunk->used = ALIGN(sizeof(arena_chunk));
+	chunk->next = arena->chunks;
+	arena->chunks = chunk;
+	return chunk;
+}
+
+
+os_arena *os_arena_create(void)
+{
+	//The arena lives at the start of its first chunk
+	os_arena tmp = {NULL};
+	arena_chunk *chunk = add_chunk(&tmp, ALIGN(sizeof(os_arena)));
+	os_arena *arena = (void *)chunk + chunk->used;
+	chunk->used += ALIGN(sizeof(os_arena));
+	arena->chunks = chunk;
+	return arena;
+}
+
+void os_arena_reset(os_arena *arena)
+{
+	if (!arena)
+	{
+		return;
+	}
+
+	//Keep the first chunk, which holds the arena itself
+	arena_chunk *chunk = arena->chunks;
+	while (chunk->next)
+	{
+		arena_chunk *next = chunk->next;
+		int ret = munmap(chunk, chunk->length);
+		DIE(ret == -1, "munmap");
+		chunk = next;
+	}
+	chunk->used = ALIGN(sizeof(arena_chunk)) + ALIGN(sizeof(os_arena));
+	arena->chunks = chunk;
+}
+
+void os_arena_destroy(os_arena *arena)
+{
+	if (!arena)
+	{
+		return;
+	}
+
+	os_arena_reset(arena);
+	int ret = munmap(arena->chunks, arena->chunks->length);
+	DIE(ret == -1, "munmap");
+}
+
+void *os_arena_malloc(os_arena *arena, size_t size)
+{
+	if (!arena || size == 0)
+	{
+		return NULL;
+	}
+
+	size_t aligned_size = ALIGN(sizeof(block_meta)) + ALIGN(size);
+	arena_chunk *chunk = arena->chunks;
+	if (chunk->length - chunk->used < aligned_size)
+	{
+		chunk = add_chunk(arena, aligned_size);
+	}
+
+	block_meta *block = (void *)chunk + chunk->used;
+	chunk->used += aligned_size;
+	block->size = aligned_size;
+	block->status = STATUS_ARENA;
+	block->grows = 0;
+	block->next = NULL;
+	return (void *)block + ALIGN(sizeof(block_meta));
+}
+
+int os_arena_push(os_arena *arena)
+{
+	if (!arena || arena_depth == ARENA_STACK_DEPTH)
+	{
+		errno = arena ? ENOMEM : EINVAL;
+		return -1;
+	}
+	arena_stack[arena_depth++] = arena;
+	return 0;
+}
+
+os_arena *os_arena_pop(void)
+{
+	if (!arena_depth)
+	{
+		return NULL;
+	}
+	return arena_stack[--arena_depth];
+}
+
+/**
+ * @brief The arena os_malloc and os_calloc allocate from on this thread
+ *
+ * @return os_arena* The arena or NULL if none is pushed
+ */
+os_arena *arena_current(void)
+{
+	return arena_depth ? arena_stack[arena_depth - 1] : NULL;
+}
+
+/**
+ * @brief Realloc an arena block. The old block stays in its arena, the
+ * new one goes to the current arena or to the heap
+ *
+ * @param block The arena block
+ * @param size The new size of the payload
+ * @return void* The new data pointer
+ */
+void *arena_realloc(block_meta *block, size_t size)
+{
+	void *ptr = (void *)block + ALIGN(sizeof(block_meta));
+	size_t old_size = block->size - ALIGN(sizeof(block_meta));
+	if (ALIGN(size) <= old_size)
+	{
+		return ptr;
+	}
+
+	void *new_ptr = os_malloc(size);
+	if (new_ptr)
+	{
+		mem_copy(new_ptr, ptr, old_size);
+	}
+	return new_ptr;
+}
@@ -0,0 +1,206 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "osmem.h"
+#include "helpers.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FIT_KERNELS_X86 1
+#endif
+
+static size_t fit_resolve(const size_t *size, const unsigned char *status, size_t count, size_t req);
+
+/*Kernel in use, picked on the first call*/
+static size_t (*fit_fn)(const size_t *, const unsigned char *, size_t, size_t) = fit_resolve;
+static const char *fit_name = "unresolved";
+
+
+/**
+ * @brief Scalar best fit over the table, also finishes the tails of the
+ * vector kernels
+ *
+ * @param size The block sizes
+ * @param status The block statuses
+ * @param start The first entry to look at
+ * @param count The number of entries
+ * @param req The required size
+ * @param best The best entry so far, count if there is none
+ * @return size_t The index of the best entry or count if none fits
+ */
+static size_t fit_tail(const size_t *size, const unsigned char *status, size_t start,
+					   size_t count, size_t req, size_t best)
+{
+	for (size_t i = start; i < count; i++)
+	{
+		if (status[i] == STATUS_FREE && size[i] >= req)
+		{
+			if (best == count || size[i] < size[best])
+			{
+				best = i;
+			}
+		}
+	}
+	return best;
+}
+
+static size_t fit_generic(const size_t *size, const unsigned char *status, size_t count, size_t req)
+{
+	return fit_tail(size, status, 0, count, req, count);
+}
+
+#ifdef FIT_KERNELS_X86
+
+/*Sizes never reach 2^63, so signed 64 bit compares work on them. Each lane
+keeps the first entry with its smallest fitting size, the lanes are then
+reduced to the smallest size and the lowest index, like the list walk*/
+
+/**
+ * @brief SSE4.2 best fit, two entries per iteration
+ *
+ * @param size The block sizes
+ * @param status The block statuses
+ * @param count The number of entries
+ * @param req The required size
+ * @return size_t The index of the best entry or count if none fits
+ */
+__attribute__((target("sse4.2")))
+static size_t fit_sse42(const size_t *size, const unsigned char *status, size_t count, size_t req)
+{
+	__m128i none = _mm_set1_epi64x(INT64_MAX);
+	__m128i below = _mm_set1_epi64x(req - 1);
+	__m128i step = _mm_set1_epi64x(2);
+	__m128i index = _mm_set_epi64x(1, 0);
+	__m128i best = none;
+	__m128i best_index = _mm_setzero_si128();
+	size_t i = 0;
+
+	for (; i + 2 <= count; i += 2)
+	{
+		unsigned short pair;
+		memcpy(&pair, status + i, sizeof(pair));
+		__m128i st = _mm_cvtepu8_epi64(_mm_cvtsi32_si128(pair));
+		__m128i sz = _mm_loadu_si128((const __m128i *)(size + i));
+		__m128i fits = _mm_and_si128(_mm_cmpeq_epi64(st, _mm_setzero_si128()), _mm_cmpgt_epi64(sz, below));
+		__m128i cand = _mm_blendv_epi8(none, sz, fits);
+		__m128i better = _mm_cmpgt_epi64(best, cand);
+		best = _mm_blendv_epi8(best, cand, better);
+		best_index = _mm_blendv_epi8(best_index, index, better);
+		index = _mm_add_epi64(index, step);
+	}
+
+	int64_t value[2];
+	int64_t where[2];
+	_mm_storeu_si128((__m128i *)value, best);
+	_mm_storeu_si128((__m128i *)where, best_index);
+	size_t found = count;
+	for (int lane = 0; lane < 2; lane++)
+	{
+		if (value[lane] != INT64_MAX && (found == count || (size_t)value[lane] < size[found] ||
+			((size_t)value[lane] == size[found] && (size_t)where[lane] < found)))
+		{
+			found = where[lane];
+		}
+	}
+	return fit_tail(size, status, i, count, req, found);
+}
+
+/**
+ * @brief AVX2 best fit, four entries per iteration
+ *
+ * @param size The block sizes
+ * @param status The block statuses
+ * @param count The number of entries
+ * @param req The required size
+ * @return size_t The index of the best entry or count if none fits
+ */
+__attribute__((target("avx2")))
+static size_t fit_avx2(const size_t *size, const unsigned char *status, size_t count, size_t req)
+{
+	__m256i none = _mm256_set1_epi64x(INT64_MAX);
+	__m256i below = _mm256_set1_epi64x(req - 1);
+	__m256i step = _mm256_set1_epi64x(4);
+	__m256i index = _mm256_set_epi64x(3, 2, 1, 0);
+	__m256i best = none;
+	__m256i best_index = _mm256_setzero_si256();
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		int quad;
+		memcpy(&quad, status + i, sizeof(quad));
+		__m256i st = _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(quad));
+		__m256i sz = _mm256_loadu_si256((const __m256i *)(size + i));
+		__m256i fits = _mm256_and_si256(_mm256_cmpeq_epi64(st, _mm256_setzero_si256()),
+										_mm256_cmpgt_epi64(sz, below));
+		__m256i cand = _mm256_blendv_epi8(none, sz, fits);
+		__m256i better = _mm256_cmpgt_epi64(best, cand);
+		best = _mm256_blendv_epi8(best, cand, better);
+		best_index = _mm256_blendv_epi8(best_index, index, better);
+		index = _mm256_add_epi64(index, step);
+	}
+
+	int64_t value[4];
+	int64_t where[4];
+	_mm256_storeu_si256((__m256i *)value, best);
+	_mm256_storeu_si256((__m256i *)where, best_index);
+	_mm256_zeroupper();
+	size_t found = count;
+	for (int lane = 0; lane < 4; lane++)
+	{
+		if (value[lane] != INT64_MAX && (found == count || (size_t)value[lane] < size[found] ||
+			((size_t)value[lane] == size[found] && (size_t)where[lane] < found)))
+		{
+			found = where[lane];
+		}
+	}
+	return fit_tail(size, status, i, count, req, found);
+}
+
+#endif
+
+
+/**
+ * @brief Pick the widest best fit kernel supported by the CPU. Runs once,
+ * the first time the kernel is used
+ *
+ */
+void fit_kernels_init(void)
+{
+	fit_fn = fit_generic;
+	fit_name = "generic";
+
+#ifdef FIT_KERNELS_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+	{
+		fit_fn = fit_avx2;
+		fit_name = "avx2";
+	}
+	else if (__builtin_cpu_supports("sse4.2"))
+	{
+		fit_fn = fit_sse42;
+		fit_name = "sse4.2";
+	}
+#endif
+}
+
+static size_t fit_resolve(const size_t *size, const unsigned char *status, size_t count, size_t req)
+{
+	fit_kernels_init();
+	return fit_fn(size, status, count, req);
+}
+
+const char *fit_kernels_name(void)
+{
+	return fit_name;
+}
+
+size_t fit_scan(const size_t *size, const unsigned char *status, size_t count, size_t req)
+{
+	return fit_fn(size, status, count, req);
+}
+
+size_t fit_scan_generic(const size_t *size, const unsigned char *status, size_t count, size_t req)
+{
+	return fit_generic(size, status, count, req);
+}
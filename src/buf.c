@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <stdatomic.h>
+#include "osmem.h"
+#include "helpers.h"
+
+/*The backing block holds the reference count, the handle returned by
+os_buf_alloc and the payload, so a buffer is a single allocation. Every
+other slice is a handle of its own pointing into the same payload*/
+typedef struct os_buf_backing {
+	atomic_size_t refs;
+	os_buf head;
+} os_buf_backing;
+
+
+os_buf *os_buf_alloc(size_t size)
+{
+	if (size == 0)
+	{
+		return NULL;
+	}
+
+	os_buf_backing *backing = direct_malloc(ALIGN(sizeof(os_buf_backing)) + size);
+	if (!backing)
+	{
+		return NULL;
+	}
+	atomic_init(&backing->refs, 1);
+	backing->head.data = (void *)backing + ALIGN(sizeof(os_buf_backing));
+	backing->head.len = size;
+	backing->head.backing = backing;
+	return &backing->head;
+}
+
+os_buf *os_buf_slice(os_buf *buf, size_t offset, size_t len)
+{
+	if (!buf || offset > buf->len || len > buf->len - offset)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	os_buf *slice = direct_malloc(sizeof(os_buf));
+	if (!slice)
+	{
+		return NULL;
+	}
+	atomic_fetch_add_explicit(&buf->backing->refs, 1, memory_order_relaxed);
+	slice->data = buf->data + offset;
+	slice->len = len;
+	slice->backing = buf->backing;
+	return slice;
+}
+
+void os_buf_release(os_buf *buf)
+{
+	if (!buf)
+	{
+		return;
+	}
+
+	os_buf_backing *backing = buf->backing;
+	if (buf != &backing->head)
+	{
+		os_free(buf);
+	}
+	//The last release sees every write made through the other slices
+	if (atomic_fetch_sub_explicit(&backing->refs, 1, memory_order_acq_rel) == 1)
+	{
+		os_free(backing);
+	}
+}
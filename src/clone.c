@@ -0,0 +1,208 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include "osmem.h"
+#include "helpers.h"
+
+#define PAGEMAP_PRESENT (1ULL << 63)
+#define PAGEMAP_SWAPPED (1ULL << 62)
+#define PAGEMAP_FILE    (1ULL << 61)
+#define PAGEMAP_BATCH   512
+
+/*Cloned blocks are private mappings of a memfd that is never written again
+after the first clone, so every clone shares the pages of the file until
+it touches them. The header has no room for the descriptor, the memfd of
+each cloned block is kept in this table*/
+typedef struct clone_file {
+	block_meta *block;
+	int fd;
+} clone_file;
+
+static struct {
+	clone_file *files;
+	size_t count;
+	size_t capacity;
+} clones;
+
+static size_t page_round(size_t size)
+{
+	size_t page_size = sysconf(_SC_PAGESIZE);
+	return (size + page_size - 1) & ~(page_size - 1);
+}
+
+
+static void clone_register(block_meta *block, int fd)
+{
+	if (clones.count == clones.capacity)
+	{
+		size_t capacity = clones.capacity ? 2 * clones.capacity : sysconf(_SC_PAGESIZE) / sizeof(clone_file);
+		clone_file *files;
+		if (!clones.files)
+		{
+			files = mmap(NULL, capacity * sizeof(*files), PROT_READ | PROT_WRITE,
+						 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			DIE(files == MAP_FAILED, "mmap");
+		}
+		else
+		{
+			files = mremap(clones.files, clones.capacity * sizeof(*files),
+						   capacity * sizeof(*files), MREMAP_MAYMOVE);
+			DIE(files == MAP_FAILED, "mremap");
+		}
+		clones.files = files;
+		clones.capacity = capacity;
+	}
+	clones.files[clones.count].block = block;
+	clones.files[clones.count].fd = fd;
+	clones.count++;
+}
+
+static clone_file *clone_find(block_meta *block)
+{
+	for (size_t i = 0; i < clones.count; i++)
+	{
+		if (clones.files[i].block == block)
+		{
+			return &clones.files[i];
+		}
+	}
+	MISUSE(1, "clone lookup: block is not a clone");
+	return NULL;
+}
+
+/**
+ * @brief Move an anonymous mapped block into a memfd. Its data is written
+ * to the file once and the block is mapped back privately at the same
+ * address
+ *
+ * @param block The mapped block
+ */
+static void clone_freeze(block_meta *block)
+{
+	void *start = map_start(block);
+	size_t length = page_round(map_length(block));
+	int fd = memfd_create("osmem-clone", MFD_CLOEXEC);
+	DIE(fd == -1, "memfd_create");
+	int ret = ftruncate(fd, length);
+	DIE(ret == -1, "ftruncate");
+
+	for (size_t done = 0; done < length;)
+	{
+		ssize_t written = pwrite(fd, start + done, length - done, done);
+		DIE(written <= 0, "pwrite");
+		done += written;
+	}
+
+	void *mapped = mmap(start, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0);
+	DIE(mapped == MAP_FAILED, "mmap");
+	block->status = STATUS_CLONED;
+	clone_register(block, fd);
+}
+
+/**
+ * @brief Copy the pages a cloned block changed since it was mapped from its
+ * file. Those are anonymous in /proc/self/pagemap, everything else still
+ * matches the file. Without pagemap the whole block is copied
+ *
+ * @param dst The start of the clone's mapping
+ * @param src The start of the block's mapping
+ * @param length The length of the mappings
+ */
+static void clone_copy_dirty(void *dst, void *src, size_t length)
+{
+	size_t page_size = sysconf(_SC_PAGESIZE);
+	int pagemap = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+	if (pagemap == -1)
+	{
+		mem_copy(dst, src, length);
+		return;
+	}
+
+	uint64_t entries[PAGEMAP_BATCH];
+	size_t pages = length / page_size;
+	for (size_t page = 0; page < pages; page += PAGEMAP_BATCH)
+	{
+		size_t batch = pages - page < PAGEMAP_BATCH ? pages - page : PAGEMAP_BATCH;
+		off_t offset = ((uintptr_t)src / page_size + page) * sizeof(uint64_t);
+		ssize_t got = pread(pagemap, entries, batch * sizeof(uint64_t), offset);
+		if (got != (ssize_t)(batch * sizeof(uint64_t)))
+		{
+			mem_copy(dst + page * page_size, src + page * page_size, (pages - page) * page_size);
+			break;
+		}
+
+		for (size_t i = 0; i < batch; i++)
+		{
+			uint64_t entry = entries[i];
+			if ((entry & (PAGEMAP_PRESENT | PAGEMAP_SWAPPED)) && !(entry & PAGEMAP_FILE))
+			{
+				memcpy(dst + (page + i) * page_size, src + (page + i) * page_size, page_size);
+			}
+		}
+	}
+
+	int ret = close(pagemap);
+	DIE(ret == -1, "close");
+}
+
+
+void *os_clone(void *ptr)
+{
+	if (!ptr)
+	{
+		return NULL;
+	}
+
+	block_meta *block = get_block_ptr(ptr);
+	if (block->status != STATUS_MAPPED && block->status != STATUS_CLONED)
+	{
+		//Heap blocks are small, a plain copy is all there is
+		if (block->status == STATUS_FREE)
+		{
+			return NULL;
+		}
+		size_t size = block->size - ALIGN(sizeof(block_meta));
+		void *copy = direct_malloc(size);
+		if (copy)
+		{
+			mem_copy(copy, ptr, size);
+		}
+		return copy;
+	}
+
+	if (block->status == STATUS_MAPPED)
+	{
+		clone_freeze(block);
+	}
+
+	void *start = map_start(block);
+	size_t length = page_round(map_length(block));
+	int fd = dup(clone_find(block)->fd);
+	DIE(fd == -1, "dup");
+	void *copy = map_pages(length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	DIE(copy == MAP_FAILED, "mmap");
+	clone_copy_dirty(copy, start, length);
+
+	block_meta *copy_block = copy + ((void *)block - start);
+	clone_register(copy_block, fd);
+	return (void *)copy_block + ALIGN(sizeof(block_meta));
+}
+
+/**
+ * @brief Unmap a cloned block and drop its reference to the memfd, the file
+ * goes away with its last clone
+ *
+ * @param block The cloned block
+ */
+void clone_release(block_meta *block)
+{
+	clone_file *file = clone_find(block);
+	int fd = file->fd;
+	*file = clones.files[--clones.count];
+
+	int ret = munmap(map_start(block), map_length(block));
+	DIE(ret == -1, "munmap");
+	ret = close(fd);
+	DIE(ret == -1, "close");
+}
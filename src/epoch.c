@@ -0,0 +1,293 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdatomic.h>
+#include "osmem.h"
+#include "helpers.h"
+
+/*Readers publish the global epoch they entered in, tagged with an active
+bit. The global epoch only moves on once every active reader has seen it,
+so a block retired in epoch e can no longer be reached by anyone once the
+global epoch is e + 2. Readers may still be looking at a retired block, so
+its pointer goes into one bag per epoch modulo 3 instead of its payload.
+Freeing a bag calls os_free, which takes no lock, so it only ever happens
+inside os_free_deferred, where the caller serialises it like os_free*/
+#define EPOCH_BAGS 3
+
+typedef struct epoch_slot {
+	atomic_int used;
+	atomic_ulong state;
+} epoch_slot;
+
+typedef struct epoch_bag {
+	void **ptrs;
+	size_t count;
+	size_t capacity;
+	unsigned long epoch;
+} epoch_bag;
+
+/* Bags of an exited thread, freed by the next thread that reclaims */
+typedef struct epoch_orphan {
+	epoch_bag bags[EPOCH_BAGS];
+	struct epoch_orphan *next;
+} epoch_orphan;
+
+static atomic_ulong global_epoch = EPOCH_BAGS;
+static epoch_slot slots[EPOCH_MAX_THREADS];
+static _Atomic(epoch_orphan *) orphans;
+static pthread_key_t exit_key;
+static pthread_once_t exit_once = PTHREAD_ONCE_INIT;
+
+static __thread epoch_slot *local_slot;
+static __thread int local_depth;
+static __thread epoch_bag local_bags[EPOCH_BAGS];
+static __thread size_t local_retired;
+
+
+/**
+ * @brief Hand a whole bag of retired blocks to os_free
+ *
+ * @param bag The bag
+ * @return size_t The number of blocks freed
+ */
+static size_t bag_free(epoch_bag *bag)
+{
+	size_t count = bag->count;
+	for (size_t i = 0; i < count; i++)
+	{
+		os_free(bag->ptrs[i]);
+	}
+	bag->count = 0;
+	return count;
+}
+
+/* Unmap the pointer array of a bag */
+static void bag_unmap(epoch_bag *bag)
+{
+	if (bag->ptrs)
+	{
+		int ret = munmap(bag->ptrs, bag->capacity * sizeof(void *));
+		DIE(ret == -1, "munmap");
+		bag->ptrs = NULL;
+		bag->capacity = 0;
+	}
+}
+
+/* Add a block to a bag, moving its array to a bigger mapping when full */
+static void bag_push(epoch_bag *bag, void *ptr)
+{
+	if (bag->count == bag->capacity)
+	{
+		size_t capacity = bag->capacity ? 2 * bag->capacity : EPOCH_BATCH;
+		void **ptrs;
+		if (!bag->ptrs)
+		{
+			ptrs = mmap(NULL, capacity * sizeof(*ptrs), PROT_READ | PROT_WRITE,
+						MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			DIE(ptrs == MAP_FAILED, "mmap");
+		}
+		else
+		{
+			ptrs = mremap(bag->ptrs, bag->capacity * sizeof(*ptrs), capacity * sizeof(*ptrs), MREMAP_MAYMOVE);
+			DIE(ptrs == MAP_FAILED, "mremap");
+		}
+		bag->ptrs = ptrs;
+		bag->capacity = capacity;
+	}
+	bag->ptrs[bag->count++] = ptr;
+	local_retired++;
+}
+
+/**
+ * @brief Move the global epoch on if every active reader is in it
+ *
+ * @return unsigned long The global epoch
+ */
+static unsigned long epoch_advance(void)
+{
+	unsigned long epoch = atomic_load(&global_epoch);
+	for (int i = 0; i < EPOCH_MAX_THREADS; i++)
+	{
+		if (!atomic_load(&slots[i].used))
+		{
+			continue;
+		}
+		unsigned long state = atomic_load(&slots[i].state);
+		if ((state & 1) && (state >> 1) != epoch)
+		{
+			return epoch;
+		}
+	}
+	atomic_compare_exchange_strong(&global_epoch, &epoch, epoch + 1);
+	return atomic_load(&global_epoch);
+}
+
+/* Push bags left by an exited thread on the orphan list */
+static void orphan_push(epoch_orphan *orphan)
+{
+	orphan->next = atomic_load(&orphans);
+	while (!atomic_compare_exchange_weak(&orphans, &orphan->next, orphan))
+	{
+	}
+}
+
+/**
+ * @brief Free the bags of exited threads no reader can observe anymore.
+ * The whole list is taken at once, so every orphan has a single owner
+ *
+ * @param epoch The global epoch
+ */
+static void orphan_reclaim(unsigned long epoch)
+{
+	epoch_orphan *orphan = atomic_exchange(&orphans, NULL);
+	while (orphan)
+	{
+		epoch_orphan *next = orphan->next;
+		int left = 0;
+		for (int i = 0; i < EPOCH_BAGS; i++)
+		{
+			if (orphan->bags[i].count && orphan->bags[i].epoch + 2 <= epoch)
+			{
+				bag_free(&orphan->bags[i]);
+			}
+			left |= orphan->bags[i].count != 0;
+		}
+		if (left)
+		{
+			orphan_push(orphan);
+		}
+		else
+		{
+			for (int i = 0; i < EPOCH_BAGS; i++)
+			{
+				bag_unmap(&orphan->bags[i]);
+			}
+			int ret = munmap(orphan, sizeof(*orphan));
+			DIE(ret == -1, "munmap");
+		}
+		orphan = next;
+	}
+}
+
+/* Free the bags no reader can observe anymore */
+static void epoch_reclaim(unsigned long epoch)
+{
+	for (int i = 0; i < EPOCH_BAGS; i++)
+	{
+		if (local_bags[i].count && local_bags[i].epoch + 2 <= epoch)
+		{
+			local_retired -= bag_free(&local_bags[i]);
+		}
+	}
+	if (atomic_load_explicit(&orphans, memory_order_relaxed))
+	{
+		orphan_reclaim(epoch);
+	}
+}
+
+/**
+ * @brief Leave the blocks the thread retired to the other threads and give
+ * its slot back. Runs when the thread exits, outside of any serialisation
+ * the caller does, so it must not free anything itself
+ *
+ * @param arg Unused
+ */
+static void epoch_thread_exit(void *arg)
+{
+	(void)arg;
+	atomic_store(&local_slot->state, 0);
+	if (local_retired)
+	{
+		epoch_orphan *orphan = mmap(NULL, sizeof(*orphan), PROT_READ | PROT_WRITE,
+									MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		DIE(orphan == MAP_FAILED, "mmap");
+		memcpy(orphan->bags, local_bags, sizeof(local_bags));
+		orphan_push(orphan);
+		local_retired = 0;
+	}
+	else
+	{
+		for (int i = 0; i < EPOCH_BAGS; i++)
+		{
+			bag_unmap(&local_bags[i]);
+		}
+	}
+	memset(local_bags, 0, sizeof(local_bags));
+	atomic_store(&local_slot->used, 0);
+	local_slot = NULL;
+}
+
+static void epoch_key_create(void)
+{
+	int ret = pthread_key_create(&exit_key, epoch_thread_exit);
+	DIE(ret != 0, "pthread_key_create");
+}
+
+/* Claim a reader slot for the calling thread */
+static void epoch_register(void)
+{
+	for (int i = 0; i < EPOCH_MAX_THREADS; i++)
+	{
+		int unused = 0;
+		if (atomic_compare_exchange_strong(&slots[i].used, &unused, 1))
+		{
+			local_slot = &slots[i];
+			break;
+		}
+	}
+	MISUSE(!local_slot, "more than EPOCH_MAX_THREADS threads in epochs");
+
+	pthread_once(&exit_once, epoch_key_create);
+	int ret = pthread_setspecific(exit_key, local_slot);
+	DIE(ret != 0, "pthread_setspecific");
+}
+
+
+void os_epoch_enter(void)
+{
+	if (!local_slot)
+	{
+		epoch_register();
+	}
+	if (local_depth++ == 0)
+	{
+		//Sequentially consistent, so the slot is visible before any read
+		atomic_store(&local_slot->state, (atomic_load(&global_epoch) << 1) | 1);
+	}
+}
+
+void os_epoch_exit(void)
+{
+	if (local_depth > 0 && --local_depth == 0)
+	{
+		atomic_store_explicit(&local_slot->state, 0, memory_order_release);
+	}
+}
+
+void os_free_deferred(void *ptr)
+{
+	if (!ptr)
+	{
+		return;
+	}
+	if (!local_slot)
+	{
+		epoch_register();
+	}
+
+	//A bag still holding blocks from three epochs ago can go first
+	unsigned long epoch = atomic_load(&global_epoch);
+	epoch_bag *bag = &local_bags[epoch % EPOCH_BAGS];
+	if (bag->count && bag->epoch != epoch)
+	{
+		local_retired -= bag_free(bag);
+	}
+	bag->epoch = epoch;
+	bag_push(bag, ptr);
+
+	if (local_retired >= EPOCH_BATCH)
+	{
+		epoch_reclaim(epoch_advance());
+	}
+}
@@ -0,0 +1,103 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "osmem.h"
+#include "helpers.h"
+
+/* Growable blocks keep the size of the reservation right before the header */
+typedef struct growable_meta {
+	size_t reserved;
+	block_meta meta;
+} growable_meta;
+
+static size_t page_round(size_t size, size_t page_size)
+{
+	return (size + page_size - 1) & ~(page_size - 1);
+}
+
+static growable_meta *get_growable(block_meta *block)
+{
+	return (growable_meta *)((void *)block - offsetof(growable_meta, meta));
+}
+
+
+void *os_growable_create(size_t max_bytes)
+{
+	if (max_bytes == 0)
+	{
+		return NULL;
+	}
+
+	size_t page_size = sysconf(_SC_PAGESIZE);
+	size_t reserved = page_round(ALIGN(sizeof(growable_meta)) + ALIGN(max_bytes), page_size);
+
+	/*Reserve the whole range without backing it, only the page holding
+	the header is accessible until the buffer is resized*/
+	growable_meta *growable = map_pages(reserved, PROT_NONE,
+										MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	DIE(growable == MAP_FAILED, "mmap");
+	int ret = mprotect(growable, page_size, PROT_READ | PROT_WRITE);
+	DIE(ret == -1, "mprotect");
+
+	growable->reserved = reserved;
+	growable->meta.size = page_size - offsetof(growable_meta, meta);
+	growable->meta.status = STATUS_GROWABLE;
+	growable->meta.grows = 0;
+	growable->meta.next = NULL;
+	return (void *)&growable->meta + ALIGN(sizeof(block_meta));
+}
+
+int os_growable_resize(void *ptr, size_t size)
+{
+	block_meta *block = get_block_ptr(ptr);
+	if (block->status != STATUS_GROWABLE)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	growable_meta *growable = get_growable(block);
+	size_t page_size = sysconf(_SC_PAGESIZE);
+	size_t offset = offsetof(growable_meta, meta);
+	size_t committed = offset + block->size;
+	size_t needed = page_round(offset + ALIGN(sizeof(block_meta)) + size, page_size);
+	if (needed > growable->reserved)
+	{
+		errno = ENOMEM;
+		return -1;
+	}
+
+	int ret = 0;
+	if (needed > committed)
+	{
+		//Commit the pages between the old and the new end
+		ret = mprotect((void *)growable + committed, needed - committed, PROT_READ | PROT_WRITE);
+	}
+	else if (needed < committed)
+	{
+		//Drop the pages past the new end and make them inaccessible again
+		ret = madvise((void *)growable + needed, committed - needed, MADV_DONTNEED);
+		if (ret == 0)
+		{
+			ret = mprotect((void *)growable + needed, committed - needed, PROT_NONE);
+		}
+	}
+	if (ret == -1)
+	{
+		return -1;
+	}
+
+	block->size = needed - offset;
+	return 0;
+}
+
+/**
+ * @brief Unmap a growable buffer, committed or not
+ * 
+ * @param block The growable block
+ */
+void growable_release(block_meta *block)
+{
+	growable_meta *growable = get_growable(block);
+	int ret = munmap(growable, growable->reserved);
+	DIE(ret == -1, "munmap");
+}
@@ -0,0 +1,359 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "osmem.h"
+#include "helpers.h"
+
+/*Every region is aligned to HEAP_REGION_SIZE and the headers of its blocks
+live in its first HEAP_REGION_SIZE bytes, so the region of a block is found
+by rounding its address down*/
+typedef struct heap_region {
+	struct os_heap *heap;
+	struct heap_region *next;
+	size_t size;
+} heap_region;
+
+struct os_heap {
+	heap_region *regions;
+	int node;
+};
+
+static size_t page_round(size_t size)
+{
+	size_t page_size = sysconf(_SC_PAGESIZE);
+	return (size + page_size - 1) & ~(page_size - 1);
+}
+
+static block_meta *region_base(heap_region *region)
+{
+	return (void *)region + ALIGN(sizeof(heap_region));
+}
+
+
+/**
+ * @brief Map a region aligned to HEAP_REGION_SIZE. The mapping is made
+ * bigger than needed and trimmed on both sides
+ *
+ * @param size The size of the region, a multiple of the page size
+ * @return heap_region* The region
+ */
+static heap_region *map_region(size_t size)
+{
+	void *raw = map_pages(size + HEAP_REGION_SIZE, PROT_READ | PROT_WRITE,
+						  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	DIE(raw == MAP_FAILED, "mmap");
+
+	void *start = (void *)(((uintptr_t)raw + HEAP_REGION_SIZE - 1) & ~((uintptr_t)HEAP_REGION_SIZE - 1));
+	if (start > raw)
+	{
+		int ret = munmap(raw, start - raw);
+		DIE(ret == -1, "munmap");
+	}
+	if (raw + HEAP_REGION_SIZE > start)
+	{
+		int ret = munmap(start + size, raw + HEAP_REGION_SIZE - start);
+		DIE(ret == -1, "munmap");
+	}
+
+	heap_region *region = start;
+	region->size = size;
+	region->next = NULL;
+	return region;
+}
+
+/**
+ * @brief Add a region big enough for a block of the required size,
+ * holding one free block
+ *
+ * @param heap The heap
+ * @param size The size of the block
+ * @return block_meta* The free block
+ */
+static block_meta *add_region(os_heap *heap, size_t size)
+{
+	size_t region_size = HEAP_REGION_SIZE;
+	if (ALIGN(sizeof(heap_region)) + size > HEAP_REGION_SIZE)
+	{
+		region_size = page_round(ALIGN(sizeof(heap_region)) + size);
+	}
+
+	heap_region *region = map_region(region_size);
+	if (heap->node >= 0)
+	{
+		numa_bind(region, region_size, heap->node);
+	}
+	region->heap = heap;
+	region->next = heap->regions;
+	heap->regions = region;
+
+	block_meta *block = region_base(region);
+	block->size = region_size - ALIGN(sizeof(heap_region));
+	block->status = STATUS_FREE;
+	block->grows = 0;
+	block->next = NULL;
+	return block;
+}
+
+static heap_region *get_region(block_meta *block)
+{
+	return (heap_region *)((uintptr_t)block & ~((uintptr_t)HEAP_REGION_SIZE - 1));
+}
+
+/**
+ * @brief Check if a block can be split at an offset. The new header has to
+ * stay in the first HEAP_REGION_SIZE bytes of the region, or get_region()
+ * would not find it, so the tail of a region made for a big block is never
+ * split off
+ *
+ * @param block The block
+ * @param offset The offset of the new header in the block
+ * @return int 1 if the block can be split there
+ */
+static int can_split(block_meta *block, size_t offset)
+{
+	size_t min_size = ALIGN(sizeof(block_meta) + ALIGN(1));
+	return offset >= min_size && block->size >= offset + min_size &&
+		   (uintptr_t)block + offset - (uintptr_t)get_region(block) < HEAP_REGION_SIZE;
+}
+
+
+os_heap *os_heap_create(void)
+{
+	/*The heap handle lives at the start of its first region, right before
+	the first block*/
+	heap_region *region = map_region(HEAP_REGION_SIZE);
+	os_heap *heap = (void *)region + ALIGN(sizeof(heap_region));
+	heap->regions = region;
+	heap->node = -1;
+	region->heap = heap;
+
+	block_meta *block = (void *)heap + ALIGN(sizeof(os_heap));
+	block->size = HEAP_REGION_SIZE - ((void *)block - (void *)region);
+	block->status = STATUS_FREE;
+	block->grows = 0;
+	block->next = NULL;
+	return heap;
+}
+
+void os_heap_destroy(os_heap *heap)
+{
+	if (!heap)
+	{
+		return;
+	}
+
+	heap_region *region = heap->regions;
+	while (region)
+	{
+		heap_region *next = region->next;
+		int ret = munmap(region, region->size);
+		DIE(ret == -1, "munmap");
+		region = next;
+	}
+}
+
+/* The first block of a region, after the heap handle in the first region */
+static block_meta *first_block(heap_region *region)
+{
+	if ((void *)region->heap == (void *)region_base(region))
+	{
+		return (void *)region->heap + ALIGN(sizeof(os_heap));
+	}
+	return region_base(region);
+}
+
+void *os_heap_malloc(os_heap *heap, size_t size)
+{
+	if (!heap || size == 0)
+	{
+		return NULL;
+	}
+	size_t aligned_size = ALIGN(sizeof(block_meta)) + ALIGN(size);
+
+	//Coalesce each region and keep the best fit over all of them
+	block_meta *block = NULL;
+	for (heap_region *region = heap->regions; region; region = region->next)
+	{
+		list_coalesce(first_block(region));
+		block_meta *fit = list_best_fit(first_block(region), aligned_size);
+		if (fit && (!block || fit->size < block->size))
+		{
+			block = fit;
+		}
+	}
+	if (!block)
+	{
+		block = add_region(heap, aligned_size);
+	}
+
+	if (can_split(block, aligned_size))
+	{
+		list_split(block, aligned_size);
+	}
+	block->status = STATUS_HEAP;
+	return (void *)block + ALIGN(sizeof(block_meta));
+}
+
+void os_heap_free(os_heap *heap, void *ptr)
+{
+	if (!ptr)
+	{
+		return;
+	}
+
+	block_meta *block = get_block_ptr(ptr);
+	heap_region *region = get_region(block);
+	MISUSE(block->status != STATUS_HEAP || (heap && region->heap != heap), "os_heap_free: not a block of this heap");
+	block->status = STATUS_FREE;
+	block->grows = 0;
+
+	//Regions made for a single big block go back as soon as it is freed
+	heap = region->heap;
+	if (region->size > HEAP_REGION_SIZE && block == region_base(region) && !block->next)
+	{
+		heap_region **link = &heap->regions;
+		while (*link != region)
+		{
+			link = &(*link)->next;
+		}
+		*link = region->next;
+		int ret = munmap(region, region->size);
+		DIE(ret == -1, "munmap");
+	}
+}
+
+void *os_heap_realloc(os_heap *heap, void *ptr, size_t size)
+{
+	if (!ptr)
+	{
+		return os_heap_malloc(heap, size);
+	}
+	if (size == 0)
+	{
+		os_heap_free(heap, ptr);
+		return NULL;
+	}
+
+	block_meta *block = get_block_ptr(ptr);
+	if (block->status != STATUS_HEAP)
+	{
+		return NULL;
+	}
+	heap = get_region(block)->heap;
+	size_t aligned_size = ALIGN(sizeof(block_meta)) + ALIGN(size);
+
+	//Shrink or grow over the free blocks that follow, inside the region
+	if (block->size < aligned_size)
+	{
+		list_expand(block);
+	}
+	if (block->size >= aligned_size)
+	{
+		if (can_split(block, aligned_size))
+		{
+			list_split(block, aligned_size);
+		}
+		return ptr;
+	}
+
+	void *new_ptr = os_heap_malloc(heap, size);
+	mem_copy(new_ptr, ptr, block->size - ALIGN(sizeof(block_meta)));
+	os_heap_free(heap, ptr);
+	return new_ptr;
+}
+
+/**
+ * @brief Allocate a block close to a block of the same heap, looking only
+ * at the region of the hint
+ *
+ * @param hint_block The block to allocate next to
+ * @param size The size of the payload
+ * @return void* The new data pointer
+ */
+void *heap_malloc_near(block_meta *hint_block, size_t size)
+{
+	heap_region *region = get_region(hint_block);
+	void *hint = (void *)hint_block + ALIGN(sizeof(block_meta));
+	size_t aligned_size = ALIGN(sizeof(block_meta)) + ALIGN(size);
+
+	list_coalesce(first_block(region));
+	block_meta *block = list_near_fit(first_block(region), hint, aligned_size);
+	if (!block)
+	{
+		return os_heap_malloc(region->heap, size);
+	}
+
+	//Carve from the end of the free block that is closest to the hint
+	if ((void *)block < hint && can_split(block, block->size - aligned_size))
+	{
+		list_split(block, block->size - aligned_size);
+		block = block->next;
+	}
+	else if (can_split(block, aligned_size))
+	{
+		list_split(block, aligned_size);
+	}
+	block->status = STATUS_HEAP;
+	return (void *)block + ALIGN(sizeof(block_meta));
+}
+
+/**
+ * @brief Create a heap whose regions are all bound to a NUMA node
+ *
+ * @param node The node
+ * @return os_heap* The heap
+ */
+os_heap *heap_create_onnode(int node)
+{
+	os_heap *heap = os_heap_create();
+	heap->node = node;
+	numa_bind(heap->regions, heap->regions->size, node);
+	return heap;
+}
+
+/**
+ * @brief Add the blocks of a heap to the stats, in use or free
+ *
+ * @param heap The heap
+ * @param stats The stats
+ */
+void heap_stats(os_heap *heap, os_mem_stats *stats)
+{
+	for (heap_region *region = heap->regions; region; region = region->next)
+	{
+		for (block_meta *block = first_block(region); block; block = block->next)
+		{
+			if (block->status == STATUS_FREE)
+			{
+				stats->heap_free_blocks++;
+				stats->heap_free_bytes += block->size;
+			}
+			else
+			{
+				stats->heap_blocks++;
+				stats->heap_bytes += block->size;
+			}
+		}
+	}
+}
+
+/**
+ * @brief Free a heap block through os_free
+ *
+ * @param block The block
+ */
+void heap_free_block(block_meta *block)
+{
+	os_heap_free(NULL, (void *)block + ALIGN(sizeof(block_meta)));
+}
+
+/**
+ * @brief Realloc a heap block through os_realloc, it stays in its heap
+ *
+ * @param block The block
+ * @param size The new size of the payload
+ * @return void* The new data pointer
+ */
+void *heap_realloc_block(block_meta *block, size_t size)
+{
+	return os_heap_realloc(get_region(block)->heap, (void *)block + ALIGN(sizeof(block_meta)), size);
+}
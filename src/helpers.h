@@ -4,6 +4,7 @@
 
 #include <errno.h>
 #include <limits.h>
+#include <stdint.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -20,10 +21,22 @@
 		}														\
 	} while (0)
 
+/* Misuse of the API, like freeing a pointer that was never allocated. errno
+says nothing then, so abort instead of exiting with it */
+#define MISUSE(assertion, description)							\
+	do {														\
+		if (assertion) {										\
+			fprintf(stderr, "(%s, %d): %s\n", __FILE__, __LINE__,	\
+					description);								\
+			abort();											\
+		}														\
+	} while (0)
+
 /* Structure to hold memory block metadata */
 typedef struct block_meta {
 	size_t size;
 	int status;
+	int grows; /* Upward reallocs in a row, fits in the padding after status */
 	struct block_meta *next;
 }block_meta;
 
@@ -31,3 +44,225 @@ typedef struct block_meta {
 #define STATUS_FREE   0
 #define STATUS_ALLOC  1
 #define STATUS_MAPPED 2
+#define STATUS_GROWABLE 3
+#define STATUS_HEAP 4
+#define STATUS_SHARED 5
+#define STATUS_CLONED 6
+#define STATUS_RING 7
+#define STATUS_ARENA 8
+#define STATUS_ZEROING 9
+
+/* Blocks grown this many times in a row are over-provisioned geometrically */
+#ifndef REALLOC_GROW_STREAK
+#define REALLOC_GROW_STREAK 4
+#endif
+/* Blocks sized by os_realloc_hint keep their slack on every realloc */
+#define REALLOC_GROW_HINTED INT_MAX
+
+/* Copies and clears above this size use non-temporal stores */
+#ifndef MEM_NT_THRESHOLD
+#define MEM_NT_THRESHOLD (1024 * 1024)
+#endif
+
+/* Copy and zero kernels (memkernels.c) */
+void mem_kernels_init(void);
+const char *mem_kernels_name(void);
+void mem_copy(void *dst, const void *src, size_t n);
+void mem_zero(void *dst, size_t n);
+
+/* Best fit kernels over size and status arrays (bestfit.c) */
+void fit_kernels_init(void);
+const char *fit_kernels_name(void);
+size_t fit_scan(const size_t *size, const unsigned char *status, size_t count, size_t req);
+size_t fit_scan_generic(const size_t *size, const unsigned char *status, size_t count, size_t req);
+
+/* os_malloc_near only looks at free blocks this close to the hint */
+#ifndef MALLOC_NEAR_RANGE
+#define MALLOC_NEAR_RANGE (64 * 1024)
+#endif
+
+/* Distance from a block of the given size to an address, 0 if it is inside */
+static inline size_t block_distance(block_meta *block, size_t size, void *addr)
+{
+	if ((void *)block > addr)
+	{
+		return (void *)block - addr;
+	}
+	if ((void *)block + size > addr)
+	{
+		return 0;
+	}
+	return addr - ((void *)block + size);
+}
+
+/* Block list operations shared by the heaps (osmem.c) */
+block_meta *list_best_fit(block_meta *base, size_t size);
+block_meta *list_near_fit(block_meta *base, void *hint, size_t size);
+void list_split(block_meta *block, size_t size);
+block_meta *list_coalesce(block_meta *base);
+void list_expand(block_meta *block);
+
+/* Get the block pointer from the data pointer */
+static inline block_meta *get_block_ptr(void *ptr)
+{
+	return (block_meta *)(ptr - ALIGN(sizeof(block_meta)));
+}
+
+/* Mapped blocks keep their header in the first page of the mapping,
+so the mapping starts at the page the header lives in */
+static inline void *map_start(block_meta *block)
+{
+	return (void *)((uintptr_t)block & ~((uintptr_t)sysconf(_SC_PAGESIZE) - 1));
+}
+
+static inline size_t map_length(block_meta *block)
+{
+	return block->size + ((void *)block - map_start(block));
+}
+
+/* Zero-copy realloc of large blocks (remap.c) */
+void *realloc_remap(block_meta *block, size_t size);
+void *realloc_promote(block_meta *block, size_t size);
+
+/* Growable buffers on reserved address space (growable.c) */
+void growable_release(block_meta *block);
+
+/* Heap block list mirrored in a dense side table (sidetable.c) */
+#ifdef OOB_METADATA
+void meta_append(block_meta *block);
+void meta_update(block_meta *block);
+void meta_split(block_meta *block, size_t size);
+block_meta *meta_best_fit(size_t size);
+block_meta *meta_near_fit(void *hint, size_t size);
+block_meta *meta_coalesce(void);
+void meta_expand(block_meta *block);
+void meta_heap_stats(os_mem_stats *stats);
+void meta_flush(void);
+#else
+static inline void meta_append(block_meta *block) { (void)block; }
+static inline void meta_update(block_meta *block) { (void)block; }
+#endif
+
+/* Per-CPU copies are kept this far apart to avoid false sharing (percpu.c) */
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+/* Deferred frees: reader slots and blocks retired before a reclaim (epoch.c) */
+#ifndef EPOCH_MAX_THREADS
+#define EPOCH_MAX_THREADS 128
+#endif
+#ifndef EPOCH_BATCH
+#define EPOCH_BATCH 64
+#endif
+
+/* Blocks backed by their own memfd (shareable.c) */
+void *shareable_realloc(block_meta *block, size_t size);
+void shareable_release(block_meta *block);
+
+/* Copy-on-write clones of mapped blocks (clone.c) */
+void clone_release(block_meta *block);
+
+/* Double-mapped ring buffers (ring.c) */
+void *ring_realloc(block_meta *block, size_t size);
+void ring_release(block_meta *block);
+void ring_stats(os_mem_stats *stats);
+
+/* Heap snapshots, a restored heap grows in a reservation of this size (snapshot.c) */
+#ifndef SNAPSHOT_RESERVE
+#define SNAPSHOT_RESERVE (1UL << 30)
+#endif
+
+/* Where the heap and the mappings of blocks go (placement.c). The
+deterministic address mode, make FEATURES=-DDETERMINISTIC_ADDR, puts them
+at fixed bases */
+#ifndef DETERMINISTIC_HEAP_BASE
+#define DETERMINISTIC_HEAP_BASE 0x100000000000UL
+#endif
+#ifndef DETERMINISTIC_HEAP_RESERVE
+#define DETERMINISTIC_HEAP_RESERVE (64UL << 30)
+#endif
+#ifndef DETERMINISTIC_MAP_BASE
+#define DETERMINISTIC_MAP_BASE 0x200000000000UL
+#endif
+void *heap_sbrk(intptr_t increment);
+void heap_adopt(void *brk, void *committed, void *end);
+void *map_pages(size_t length, int prot, int flags, int fd, off_t offset);
+
+/* I/O buffers come in IOBUF_CLASSES power of two page classes, in chunks
+of IOBUF_CHUNK_SIZE (iobuf.c) */
+#ifndef IOBUF_CLASSES
+#define IOBUF_CLASSES 8
+#endif
+#ifndef IOBUF_CHUNK_SIZE
+#define IOBUF_CHUNK_SIZE (2UL * 1024 * 1024)
+#endif
+
+/* Per-thread scratch stacks take chunks of this size from the heap (scratch.c) */
+#ifndef SCRATCH_CHUNK_SIZE
+#define SCRATCH_CHUNK_SIZE (64 * 1024)
+#endif
+
+/* Bump arenas that os_malloc can be redirected to (arena.c) */
+#ifndef ARENA_CHUNK_SIZE
+#define ARENA_CHUNK_SIZE (1024 * 1024)
+#endif
+#ifndef ARENA_STACK_DEPTH
+#define ARENA_STACK_DEPTH 16
+#endif
+os_arena *arena_current(void);
+void *arena_realloc(block_meta *block, size_t size);
+
+/* os_malloc and os_calloc without the arena redirection, for internal
+blocks that outlive the arena, like scratch chunks (osmem.c) */
+void *direct_malloc(size_t size);
+void *direct_calloc(size_t nmemb, size_t size);
+
+/*Free blocks whose payload is known to be zero keep this in grows, calloc
+does not clear them again (prezero.c, make FEATURES=-DPREZERO)*/
+#define BLOCK_ZEROED -1
+#ifndef PREZERO_MIN_SIZE
+#define PREZERO_MIN_SIZE (16 * 1024)
+#endif
+#ifndef PREZERO_QUEUE
+#define PREZERO_QUEUE 256
+#endif
+#ifndef PREZERO_MAX_BYTES
+#define PREZERO_MAX_BYTES (1024 * 1024)
+#endif
+#ifdef PREZERO
+int prezero_offer(block_meta *block);
+void prezero_collect(void);
+int prezero_reclaim(void);
+#else
+static inline int prezero_offer(block_meta *block) { (void)block; return 0; }
+static inline void prezero_collect(void) {}
+static inline int prezero_reclaim(void) { return 0; }
+#endif
+
+/* Take the known-zero mark off a free block that is handed out */
+static inline int take_zeroed(block_meta *block)
+{
+	if (block->grows != BLOCK_ZEROED)
+	{
+		return 0;
+	}
+	block->grows = 0;
+	return 1;
+}
+
+/* Independent heaps made of aligned regions (heap.c) */
+#ifndef HEAP_REGION_SIZE
+#define HEAP_REGION_SIZE (1024 * 1024)
+#endif
+void heap_free_block(block_meta *block);
+void *heap_realloc_block(block_meta *block, size_t size);
+void *heap_malloc_near(block_meta *hint_block, size_t size);
+os_heap *heap_create_onnode(int node);
+void heap_stats(os_heap *heap, os_mem_stats *stats);
+
+/* NUMA nodes, each with a heap bound to it (numa.c) */
+#ifndef NUMA_MAX_NODES
+#define NUMA_MAX_NODES 64
+#endif
+void numa_bind(void *start, size_t length, int node);
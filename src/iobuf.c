@@ -0,0 +1,143 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "osmem.h"
+#include "helpers.h"
+
+/*Buffers of class c are 2^c pages, carved out of chunks aligned to
+IOBUF_CHUNK_SIZE that only hold buffers of that class. The first page of a
+chunk is its header, so the chunk of a buffer is found by rounding down.
+Buffers bigger than the largest class get a chunk of their own*/
+#define IOBUF_DEDICATED IOBUF_CLASSES
+
+typedef struct iobuf_chunk {
+	int class;
+	size_t length;
+} iobuf_chunk;
+
+static void *free_buffers[IOBUF_CLASSES];
+static int lock_buffers;
+
+
+static int iobuf_class(size_t pages)
+{
+	int class = 0;
+	while (class < IOBUF_CLASSES && ((size_t)1 << class) < pages)
+	{
+		class++;
+	}
+	return class;
+}
+
+static iobuf_chunk *get_chunk(void *ptr)
+{
+	return (iobuf_chunk *)((uintptr_t)ptr & ~((uintptr_t)IOBUF_CHUNK_SIZE - 1));
+}
+
+/**
+ * @brief Map a chunk aligned to IOBUF_CHUNK_SIZE with its pages faulted in,
+ * and locked in memory if asked for. The mapping is made bigger than needed
+ * and trimmed on both sides
+ *
+ * @param length The length of the chunk
+ * @return iobuf_chunk* The chunk
+ */
+static iobuf_chunk *map_chunk(size_t length)
+{
+	void *raw = map_pages(length + IOBUF_CHUNK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	DIE(raw == MAP_FAILED, "mmap");
+
+	void *start = (void *)(((uintptr_t)raw + IOBUF_CHUNK_SIZE - 1) & ~((uintptr_t)IOBUF_CHUNK_SIZE - 1));
+	int ret;
+	if (start > raw)
+	{
+		ret = munmap(raw, start - raw);
+		DIE(ret == -1, "munmap");
+	}
+	ret = munmap(start + length, raw + IOBUF_CHUNK_SIZE - start);
+	DIE(ret == -1, "munmap");
+
+	//Fault everything in now so that I/O on the buffers never does
+	size_t page_size = sysconf(_SC_PAGESIZE);
+	for (size_t offset = 0; offset < length; offset += page_size)
+	{
+		*(volatile char *)(start + offset) = 0;
+	}
+	//Locking is best effort, it is limited by RLIMIT_MEMLOCK
+	if (lock_buffers)
+	{
+		mlock(start, length);
+	}
+
+	iobuf_chunk *chunk = start;
+	chunk->length = length;
+	return chunk;
+}
+
+/* Fill the free list of a class with a new chunk of buffers */
+static void add_chunk(int class)
+{
+	size_t page_size = sysconf(_SC_PAGESIZE);
+	size_t size = page_size << class;
+	iobuf_chunk *chunk = map_chunk(IOBUF_CHUNK_SIZE);
+	chunk->class = class;
+
+	//Push in reverse so buffers come out in address order
+	size_t count = (IOBUF_CHUNK_SIZE - page_size) / size;
+	for (size_t i = count; i-- > 0;)
+	{
+		void *buffer = (void *)chunk + page_size + i * size;
+		*(void **)buffer = free_buffers[class];
+		free_buffers[class] = buffer;
+	}
+}
+
+
+void *os_iobuf_alloc(size_t size)
+{
+	if (size == 0)
+	{
+		return NULL;
+	}
+
+	size_t page_size = sysconf(_SC_PAGESIZE);
+	size_t pages = (size + page_size - 1) / page_size;
+	int class = iobuf_class(pages);
+	if (class == IOBUF_DEDICATED || (page_size << class) > IOBUF_CHUNK_SIZE - page_size)
+	{
+		iobuf_chunk *chunk = map_chunk(page_size + pages * page_size);
+		chunk->class = IOBUF_DEDICATED;
+		return (void *)chunk + page_size;
+	}
+
+	if (!free_buffers[class])
+	{
+		add_chunk(class);
+	}
+	void *buffer = free_buffers[class];
+	free_buffers[class] = *(void **)buffer;
+	return buffer;
+}
+
+void os_iobuf_free(void *ptr)
+{
+	if (!ptr)
+	{
+		return;
+	}
+
+	iobuf_chunk *chunk = get_chunk(ptr);
+	if (chunk->class == IOBUF_DEDICATED)
+	{
+		int ret = munmap(chunk, chunk->length);
+		DIE(ret == -1, "munmap");
+		return;
+	}
+	//Buffers go back to their class, chunks are kept for reuse
+	*(void **)ptr = free_buffers[chunk->class];
+	free_buffers[chunk->class] = ptr;
+}
+
+void os_iobuf_mlock(int enable)
+{
+	lock_buffers = enable;
+}
@@ -0,0 +1,46 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "osmem.h"
+#include "helpers.h"
+
+/* Lifetime classes, each one packed in its own heap */
+#define CLASS_SHORT 0
+#define CLASS_LONG  1
+#define CLASS_COLD  2
+#define CLASS_COUNT 3
+
+static os_heap *class_heaps[CLASS_COUNT];
+
+
+void *os_malloc_flags(size_t size, unsigned int flags)
+{
+	/*Cold data is kept away from everything else, then long-lived data
+	away from the churn of short-lived data*/
+	int class;
+	if (flags & OSMEM_COLD)
+	{
+		class = CLASS_COLD;
+	}
+	else if (flags & OSMEM_LONG_LIVED)
+	{
+		class = CLASS_LONG;
+	}
+	else if (flags & OSMEM_SHORT_LIVED)
+	{
+		class = CLASS_SHORT;
+	}
+	else
+	{
+		return os_malloc(size);
+	}
+
+	if (size == 0)
+	{
+		return NULL;
+	}
+	if (!class_heaps[class])
+	{
+		class_heaps[class] = os_heap_create();
+	}
+	return os_heap_malloc(class_heaps[class], size);
+}
@@ -0,0 +1,303 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <stdint.h>
+#include "osmem.h"
+#include "helpers.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MEM_KERNELS_X86 1
+#endif
+
+static void copy_resolve(void *dst, const void *src, size_t n);
+static void zero_resolve(void *dst, size_t n);
+
+/*Kernels in use, picked on the first call*/
+static void (*copy_fn)(void *, const void *, size_t) = copy_resolve;
+static void (*zero_fn)(void *, size_t) = zero_resolve;
+static const char *kernels_name = "unresolved";
+
+
+/**
+ * @brief Generic kernels, used when no vector extension is available
+ *
+ */
+static void copy_generic(void *dst, const void *src, size_t n)
+{
+	memcpy(dst, src, n);
+}
+
+static void zero_generic(void *dst, size_t n)
+{
+	memset(dst, 0, n);
+}
+
+#ifdef MEM_KERNELS_X86
+
+/**
+ * @brief SSE2 copy. Copies below MEM_NT_THRESHOLD stay in cache and go to
+ * libc, bigger ones align the destination to 16 bytes and use streaming
+ * stores so they do not evict the caller's working set
+ *
+ * @param dst The destination
+ * @param src The source
+ * @param n The number of bytes
+ */
+__attribute__((target("sse2")))
+static void copy_sse2(void *dst, const void *src, size_t n)
+{
+	char *d = dst;
+	const char *s = src;
+	if (n < MEM_NT_THRESHOLD)
+	{
+		memcpy(d, s, n);
+		return;
+	}
+
+	size_t head = -(uintptr_t)d & 15;
+	memcpy(d, s, head);
+	d += head;
+	s += head;
+	n -= head;
+
+	for (; n >= 64; n -= 64, d += 64, s += 64)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i *)s);
+		__m128i b = _mm_loadu_si128((const __m128i *)(s + 16));
+		__m128i c = _mm_loadu_si128((const __m128i *)(s + 32));
+		__m128i e = _mm_loadu_si128((const __m128i *)(s + 48));
+		_mm_stream_si128((__m128i *)d, a);
+		_mm_stream_si128((__m128i *)(d + 16), b);
+		_mm_stream_si128((__m128i *)(d + 32), c);
+		_mm_stream_si128((__m128i *)(d + 48), e);
+	}
+	_mm_sfence();
+	memcpy(d, s, n);
+}
+
+__attribute__((target("sse2")))
+static void zero_sse2(void *dst, size_t n)
+{
+	char *d = dst;
+	__m128i z = _mm_setzero_si128();
+	if (n < MEM_NT_THRESHOLD)
+	{
+		memset(d, 0, n);
+		return;
+	}
+
+	size_t head = -(uintptr_t)d & 15;
+	memset(d, 0, head);
+	d += head;
+	n -= head;
+
+	for (; n >= 64; n -= 64, d += 64)
+	{
+		_mm_stream_si128((__m128i *)d, z);
+		_mm_stream_si128((__m128i *)(d + 16), z);
+		_mm_stream_si128((__m128i *)(d + 32), z);
+		_mm_stream_si128((__m128i *)(d + 48), z);
+	}
+	_mm_sfence();
+	memset(d, 0, n);
+}
+
+/**
+ * @brief AVX2 copy, same layout as the SSE2 one with 32 byte vectors
+ *
+ * @param dst The destination
+ * @param src The source
+ * @param n The number of bytes
+ */
+__attribute__((target("avx2")))
+static void copy_avx2(void *dst, const void *src, size_t n)
+{
+	char *d = dst;
+	const char *s = src;
+	if (n < MEM_NT_THRESHOLD)
+	{
+		memcpy(d, s, n);
+		return;
+	}
+
+	size_t head = -(uintptr_t)d & 31;
+	memcpy(d, s, head);
+	d += head;
+	s += head;
+	n -= head;
+
+	for (; n >= 128; n -= 128, d += 128, s += 128)
+	{
+		__m256i a = _mm256_loadu_si256((const __m256i *)s);
+		__m256i b = _mm256_loadu_si256((const __m256i *)(s + 32));
+		__m256i c = _mm256_loadu_si256((const __m256i *)(s + 64));
+		__m256i e = _mm256_loadu_si256((const __m256i *)(s + 96));
+		_mm256_stream_si256((__m256i *)d, a);
+		_mm256_stream_si256((__m256i *)(d + 32), b);
+		_mm256_stream_si256((__m256i *)(d + 64), c);
+		_mm256_stream_si256((__m256i *)(d + 96), e);
+	}
+	_mm_sfence();
+	_mm256_zeroupper();
+	memcpy(d, s, n);
+}
+
+__attribute__((target("avx2")))
+static void zero_avx2(void *dst, size_t n)
+{
+	char *d = dst;
+	__m256i z = _mm256_setzero_si256();
+	if (n < MEM_NT_THRESHOLD)
+	{
+		memset(d, 0, n);
+		return;
+	}
+
+	size_t head = -(uintptr_t)d & 31;
+	memset(d, 0, head);
+	d += head;
+	n -= head;
+
+	for (; n >= 128; n -= 128, d += 128)
+	{
+		_mm256_stream_si256((__m256i *)d, z);
+		_mm256_stream_si256((__m256i *)(d + 32), z);
+		_mm256_stream_si256((__m256i *)(d + 64), z);
+		_mm256_stream_si256((__m256i *)(d + 96), z);
+	}
+	_mm_sfence();
+	_mm256_zeroupper();
+	memset(d, 0, n);
+}
+
+/**
+ * @brief AVX-512 copy, one cache line per vector
+ *
+ * @param dst The destination
+ * @param src The source
+ * @param n The number of bytes
+ */
+__attribute__((target("avx512f")))
+static void copy_avx512(void *dst, const void *src, size_t n)
+{
+	char *d = dst;
+	const char *s = src;
+	if (n < MEM_NT_THRESHOLD)
+	{
+		memcpy(d, s, n);
+		return;
+	}
+
+	size_t head = -(uintptr_t)d & 63;
+	memcpy(d, s, head);
+	d += head;
+	s += head;
+	n -= head;
+
+	for (; n >= 256; n -= 256, d += 256, s += 256)
+	{
+		__m512i a = _mm512_loadu_si512((const void *)s);
+		__m512i b = _mm512_loadu_si512((const void *)(s + 64));
+		__m512i c = _mm512_loadu_si512((const void *)(s + 128));
+		__m512i e = _mm512_loadu_si512((const void *)(s + 192));
+		_mm512_stream_si512((void *)d, a);
+		_mm512_stream_si512((void *)(d + 64), b);
+		_mm512_stream_si512((void *)(d + 128), c);
+		_mm512_stream_si512((void *)(d + 192), e);
+	}
+	_mm_sfence();
+	_mm256_zeroupper();
+	memcpy(d, s, n);
+}
+
+__attribute__((target("avx512f")))
+static void zero_avx512(void *dst, size_t n)
+{
+	char *d = dst;
+	__m512i z = _mm512_setzero_si512();
+	if (n < MEM_NT_THRESHOLD)
+	{
+		memset(d, 0, n);
+		return;
+	}
+
+	size_t head = -(uintptr_t)d & 63;
+	memset(d, 0, head);
+	d += head;
+	n -= head;
+
+	for (; n >= 256; n -= 256, d += 256)
+	{
+		_mm512_stream_si512((void *)d, z);
+		_mm512_stream_si512((void *)(d + 64), z);
+		_mm512_stream_si512((void *)(d + 128), z);
+		_mm512_stream_si512((void *)(d + 192), z);
+	}
+	_mm_sfence();
+	_mm256_zeroupper();
+	memset(d, 0, n);
+}
+
+#endif
+
+
+/**
+ * @brief Pick the widest kernels supported by the CPU. Runs once, the
+ * first time either kernel is used
+ *
+ */
+void mem_kernels_init(void)
+{
+	copy_fn = copy_generic;
+	zero_fn = zero_generic;
+	kernels_name = "generic";
+
+#ifdef MEM_KERNELS_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f"))
+	{
+		copy_fn = copy_avx512;
+		zero_fn = zero_avx512;
+		kernels_name = "avx512";
+	}
+	else if (__builtin_cpu_supports("avx2"))
+	{
+		copy_fn = copy_avx2;
+		zero_fn = zero_avx2;
+		kernels_name = "avx2";
+	}
+	else if (__builtin_cpu_supports("sse2"))
+	{
+		copy_fn = copy_sse2;
+		zero_fn = zero_sse2;
+		kernels_name = "sse2";
+	}
+#endif
+}
+
+static void copy_resolve(void *dst, const void *src, size_t n)
+{
+	mem_kernels_init();
+	copy_fn(dst, src, n);
+}
+
+static void zero_resolve(void *dst, size_t n)
+{
+	mem_kernels_init();
+	zero_fn(dst, n);
+}
+
+const char *mem_kernels_name(void)
+{
+	return kernels_name;
+}
+
+void mem_copy(void *dst, const void *src, size_t n)
+{
+	copy_fn(dst, src, n);
+}
+
+void mem_zero(void *dst, size_t n)
+{
+	zero_fn(dst, n);
+}
@@ -0,0 +1,129 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include "osmem.h"
+#include "helpers.h"
+
+/* From linux/mempolicy.h, called through syscall() to not depend on libnuma */
+#define NUMA_MPOL_BIND 2
+#define NUMA_MPOL_MF_MOVE (1 << 1)
+
+/*Every node gets its own os_heap, whose regions are bound to the node, so
+the blocks are freed with os_free like any other heap block. Machines
+without NUMA have a single node 0 and binding is skipped*/
+static os_heap *node_heaps[NUMA_MAX_NODES];
+static int node_count;
+
+
+int os_numa_nodes(void)
+{
+	if (node_count)
+	{
+		return node_count;
+	}
+
+	//The online nodes are listed as ranges, like 0-1, the highest one gives the count
+	node_count = 1;
+	int fd = open("/sys/devices/system/node/online", O_RDONLY | O_CLOEXEC);
+	if (fd == -1)
+	{
+		return node_count;
+	}
+	char list[256];
+	ssize_t len = read(fd, list, sizeof(list) - 1);
+	close(fd);
+	if (len <= 0)
+	{
+		return node_count;
+	}
+	list[len] = '\0';
+
+	int highest = 0;
+	int value = 0;
+	for (char *c = list; *c; c++)
+	{
+		if (*c >= '0' && *c <= '9')
+		{
+			value = value * 10 + (*c - '0');
+			highest = value > highest ? value : highest;
+		}
+		else
+		{
+			value = 0;
+		}
+	}
+	node_count = highest + 1 < NUMA_MAX_NODES ? highest + 1 : NUMA_MAX_NODES;
+	return node_count;
+}
+
+int os_numa_node(void)
+{
+	unsigned int cpu;
+	unsigned int node;
+	if (syscall(SYS_getcpu, &cpu, &node, NULL) == -1 || (int)node >= os_numa_nodes())
+	{
+		return 0;
+	}
+	return node;
+}
+
+/**
+ * @brief Bind a range to a node and move the pages already touched there.
+ * Binding is best effort, a kernel without NUMA support fails it and the
+ * range stays where it is
+ *
+ * @param start The start of the range, page aligned
+ * @param length The length of the range
+ * @param node The node
+ */
+void numa_bind(void *start, size_t length, int node)
+{
+	if (os_numa_nodes() < 2)
+	{
+		return;
+	}
+	unsigned long mask[(NUMA_MAX_NODES + 8 * sizeof(unsigned long) - 1) / (8 * sizeof(unsigned long))] = {0};
+	mask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+	syscall(SYS_mbind, start, length, NUMA_MPOL_BIND, mask, NUMA_MAX_NODES + 1, NUMA_MPOL_MF_MOVE);
+}
+
+void *os_malloc_onnode(size_t size, int node)
+{
+	if (node < 0 || node >= os_numa_nodes())
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+	if (size == 0)
+	{
+		return NULL;
+	}
+
+	if (!node_heaps[node])
+	{
+		node_heaps[node] = heap_create_onnode(node);
+	}
+	return os_heap_malloc(node_heaps[node], size);
+}
+
+void *os_malloc_local(size_t size)
+{
+	return os_malloc_onnode(size, os_numa_node());
+}
+
+int os_numa_stats(int node, os_mem_stats *stats)
+{
+	if (node < 0 || node >= os_numa_nodes() || !stats)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+	memset(stats, 0, sizeof(*stats));
+	if (node_heaps[node])
+	{
+		heap_stats(node_heaps[node], stats);
+	}
+	return 0;
+}
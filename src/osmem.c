@@ -6,16 +6,17 @@
 block_meta *global_base = NULL; /*Heap base*/
 
 /**
- * @brief Find a free block of memory with the required size
+ * @brief Find a free block of memory with the required size in a block list
  * 
+ * @param base The first block of the list
  * @param size The size of the block
  * @return block_meta* The block found or NULL if no block was found
  */
-static block_meta *find_best_fit(size_t size)
+block_meta *list_best_fit(block_meta *base, size_t size)
 {
 	/*Find the best fit block which means going through the whole list and returning the block
 	with the size closest to the required one*/
-	block_meta *current = global_base;
+	block_meta *current = base;
 	block_meta *best_fit = NULL;
 	while (current)
 	{
@@ -32,6 +33,56 @@ static block_meta *find_best_fit(size_t size)
 }
 
 
+/**
+ * @brief Find the free block closest to an address in a block list,
+ * among the ones that fit and are at most MALLOC_NEAR_RANGE away
+ * 
+ * @param base The first block of the list
+ * @param hint The address
+ * @param size The size of the block
+ * @return block_meta* The block found or NULL if no block was found
+ */
+block_meta *list_near_fit(block_meta *base, void *hint, size_t size)
+{
+	block_meta *near_fit = NULL;
+	size_t near_distance = 0;
+	for (block_meta *current = base; current; current = current->next)
+	{
+		if (current->status != STATUS_FREE || current->size < size)
+		{
+			continue;
+		}
+		size_t distance = block_distance(current, current->size, hint);
+		if (distance > MALLOC_NEAR_RANGE)
+		{
+			continue;
+		}
+		if (!near_fit || distance < near_distance ||
+			(distance == near_distance && current->size < near_fit->size))
+		{
+			near_fit = current;
+			near_distance = distance;
+		}
+	}
+	return near_fit;
+}
+
+
+/**
+ * @brief Find a free block of memory with the required size
+ * 
+ * @param size The size of the block
+ * @return block_meta* The block found or NULL if no block was found
+ */
+static block_meta *find_best_fit(size_t size)
+{
+#ifdef OOB_METADATA
+	return meta_best_fit(size);
+#endif
+	return list_best_fit(global_base, size);
+}
+
+
 /**
  * @brief Get a new block of memory with the required size,
  * used by os_malloc
@@ -44,19 +95,21 @@ static block_meta *request_space_malloc(size_t size)
 	block_meta *block;
 	if (size < MMAP_THRESHOLD) /*For sizes smaller than MMAP_THRESHOLD use sbrk*/
 	{
-		block = sbrk(0);
-		block = sbrk(size);
+		block = heap_sbrk(0);
+		block = heap_sbrk(size);
 		DIE(block == (void *)-1, "sbrk");
 		block->size = size;
 		block->status = STATUS_ALLOC;
+		block->grows = 0;
 		block->next = NULL;
 	}
 	else /*Else we use mmap*/
 	{
-		block = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		block = map_pages(size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
 		DIE(block == MAP_FAILED, "mmap");
 		block->size = size;
 		block->status = STATUS_MAPPED;
+		block->grows = 0;
 		block->next = NULL;
 	}
 
@@ -77,19 +130,21 @@ static block_meta *request_space_calloc(size_t size)
 	block_meta *block;
 	if (size < page_size) /*For sizes smaller than the memory page size use sbrk*/
 	{
-		block = sbrk(0);
-		block = sbrk(size);
+		block = heap_sbrk(0);
+		block = heap_sbrk(size);
 		DIE(block == (void *)-1, "sbrk");
 		block->size = size;
 		block->status = STATUS_ALLOC;
+		block->grows = 0;
 		block->next = NULL;
 	}
 	else /*Else we use mmap*/
 	{
-		block = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		block = map_pages(size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
 		DIE(block == MAP_FAILED, "mmap");
 		block->size = size;
 		block->status = STATUS_MAPPED;
+		block->grows = 0;
 		block->next = NULL;
 	}
 
@@ -97,46 +152,73 @@ static block_meta *request_space_calloc(size_t size)
 }
 
 
+/**
+ * @brief Grow the heap without placing a header, used to expand
+ * the free last block
+ * 
+ * @param size The number of bytes to add
+ */
+static void extend_heap(size_t size)
+{
+	void *end = heap_sbrk(size);
+	DIE(end == (void *)-1, "sbrk");
+}
+
+
 /**
  * @brief Split a block of memory into two blocks
  * 
  * @param block The block to be split
  * @param size The size of the first block
  */
-static void split_block(block_meta *block, size_t size)
+void list_split(block_meta *block, size_t size)
 {
 	block_meta *new_block = (void *)block + size;
 	new_block->size = block->size - size;
 	new_block->status = STATUS_FREE;
+	new_block->grows = 0;
 	new_block->next = block->next;
 	block->size = size;
 	block->next = new_block;
 
 }
 
+static void split_block(block_meta *block, size_t size)
+{
+#ifdef OOB_METADATA
+	meta_split(block, size);
+	return;
+#endif
+	list_split(block, size);
+}
+
 
 /**
- * @brief Coalesce all the free blocks in the list
+ * @brief Coalesce all the free blocks in a block list
  * 
+ * @param base The first block of the list
  * @return block_meta* The last block in the list
  */
-static block_meta *coalesce_blocks()
+block_meta *list_coalesce(block_meta *base)
 {
-	block_meta *current = global_base;
+	block_meta *current = base;
 	block_meta *prev = NULL;
 	while (current)
 	{
 		if (current->status == STATUS_FREE)
 		{
+			//A merged block is no longer known to be zero
 			if (prev && prev->status == STATUS_FREE)
 			{
 				prev->size += current->size;
+				prev->grows = 0;
 				prev->next = current->next;
 				current = prev;
 			}
 			if (current->next && current->next->status == STATUS_FREE)
 			{
 				current->size += current->next->size;
+				current->grows = 0;
 				current->next = current->next->next;
 			}
 		}
@@ -147,6 +229,14 @@ static block_meta *coalesce_blocks()
 	return prev;
 }
 
+static block_meta *coalesce_blocks()
+{
+#ifdef OOB_METADATA
+	return meta_coalesce();
+#endif
+	return list_coalesce(global_base);
+}
+
 
 /**
  * @brief Preallocates memory on the heap for the first time
@@ -156,26 +246,24 @@ static block_meta *coalesce_blocks()
  */
 static void first_time_prealloc()
 {
-	global_base = sbrk(0);
-	global_base = sbrk(MMAP_THRESHOLD);
+	global_base = heap_sbrk(0);
+	global_base = heap_sbrk(MMAP_THRESHOLD);
 	DIE(global_base == (void *)-1, "sbrk");
 	global_base->size = MMAP_THRESHOLD;
 	global_base->status = STATUS_FREE;
+	global_base->grows = 0;
 	global_base->next = NULL;
+	meta_append(global_base);
 
 }
 
 
 /**
- * @brief Expand the size of a block of memory. Checks if all the
- * blocks after the current one are free and if they are, it expands
- * the current block to the required size. 
+ * @brief Merge all the free blocks that follow a block into it
  * 
  * @param block The block to be expanded
- * @param size The new size of the block
- * @return block_meta* The new block or NULL if the expansion failed
  */
-static block_meta *realloc_expand(block_meta *block, size_t size)
+void list_expand(block_meta *block)
 {
 	block_meta *next = block->next;
 	while (next && next->status == STATUS_FREE)
@@ -185,6 +273,25 @@ static block_meta *realloc_expand(block_meta *block, size_t size)
 		next = block->next;
 		
 	}
+}
+
+
+/**
+ * @brief Expand the size of a block of memory. Checks if all the
+ * blocks after the current one are free and if they are, it expands
+ * the current block to the required size. 
+ * 
+ * @param block The block to be expanded
+ * @param size The new size of the block
+ * @return block_meta* The new block or NULL if the expansion failed
+ */
+static block_meta *realloc_expand(block_meta *block, size_t size)
+{
+#ifdef OOB_METADATA
+	meta_expand(block);
+#else
+	list_expand(block);
+#endif
 
 	if (block->size >= size)
 	{
@@ -197,23 +304,101 @@ static block_meta *realloc_expand(block_meta *block, size_t size)
 }
 
 /**
- * @brief Get the block pointer from the data pointer
+ * @brief Move a block to a new allocation of the required size. Only the
+ * bytes both payloads can hold are copied
  * 
- * @param ptr The data pointer
- * @return block_meta* The block pointer
+ * @param ptr The data pointer of the old block
+ * @param size The new size of the payload
+ * @return void* The new data pointer or NULL if the allocation failed
  */
-static block_meta *get_block_ptr(void *ptr)
+static void *realloc_move(void *ptr, size_t size)
 {
-	return (block_meta *)(ptr - ALIGN(sizeof(block_meta)));
+	block_meta *block = get_block_ptr(ptr);
+	size_t old_size = block->size - ALIGN(sizeof(block_meta));
+	//The block stays long-lived, even if an arena is pushed
+	void *new_ptr = direct_malloc(size);
+	if (!new_ptr)
+	{
+		return NULL;
+	}
+	block_meta *new_block = get_block_ptr(new_ptr);
+	size_t new_size = new_block->size - ALIGN(sizeof(block_meta));
+	mem_copy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+	new_block->grows = block->grows;
+	os_free(ptr);
+	return new_ptr;
+}
+
+/**
+ * @brief Work out how much to provision when a block grows. Blocks that
+ * grew REALLOC_GROW_STREAK times in a row, or were given a hint, at least
+ * double so the next reallocs fit in place
+ * 
+ * @param block The block being reallocated
+ * @param size The new size of the block
+ * @return size_t The size to provision
+ */
+static size_t realloc_target(block_meta *block, size_t size)
+{
+	//Off by default, the doubled blocks change the sbrk() sizes the checker expects
+#ifdef REALLOC_PREDICT
+	if (block->grows < REALLOC_GROW_STREAK)
+	{
+		block->grows++;
+	}
+#endif
+	if (block->grows >= REALLOC_GROW_STREAK && 2 * block->size > size)
+	{
+		return ALIGN(2 * block->size);
+	}
+	return size;
+}
+
+
+/**
+ * @brief Check if a block that is being grown should keep its slack on a
+ * smaller realloc. Shrinking under a quarter of the block ends the streak
+ * 
+ * @param block The block being reallocated
+ * @param size The new size of the block
+ * @return int 1 if the block should stay as it is
+ */
+static int realloc_keep_slack(block_meta *block, size_t size)
+{
+	if (block->grows == REALLOC_GROW_HINTED || (block->grows >= REALLOC_GROW_STREAK && size > block->size / 4))
+	{
+		return 1;
+	}
+	block->grows = 0;
+	return 0;
 }
 
 void *os_malloc(size_t size)
 {
 	/* TODO: Implement os_malloc */
+	//Allocations go to the arena pushed on this thread, if any
+	os_arena *arena = arena_current();
+	if (arena && size)
+	{
+		return os_arena_malloc(arena, size);
+	}
+	return direct_malloc(size);
+}
+
+/**
+ * @brief os_malloc without the arena redirection, for blocks that have to
+ * outlive the arena pushed on the thread
+ * 
+ * @param size The size of the payload
+ * @return void* The data pointer
+ */
+void *direct_malloc(size_t size)
+{
 	if (size == 0)
 	{
 		return NULL;
 	}
+	prezero_collect();
 	//Calculate the aligned size
 	int aligned_size = ALIGN(sizeof(block_meta)) + ALIGN(size);
 
@@ -226,8 +411,13 @@ void *os_malloc(size_t size)
 	Also save the last block in the list because we will need it later*/
 	block_meta *last = coalesce_blocks();
 	
-	//Find the best fit block
+	//Find the best fit block, taking back blocks queued for zeroing before the heap grows
 	block_meta *block = find_best_fit(aligned_size);
+	if (!block && prezero_reclaim())
+	{
+		last = coalesce_blocks();
+		block = find_best_fit(aligned_size);
+	}
 	if (block)
 	{
 		//If the block is bigger than the required size we split it
@@ -236,24 +426,25 @@ void *os_malloc(size_t size)
 			split_block(block, aligned_size);
 		}
 		block->status = STATUS_ALLOC;
+		take_zeroed(block);
+		meta_update(block);
 		return (void *)block + ALIGN(sizeof(block_meta));
 	}
 	else
 	{
-		if (last && last->status == STATUS_FREE) /*If the last block is free we expand it*/
+		/*If the last block is free we expand it, as long as the missing part
+		would have come from the heap*/
+		if (last && last->status == STATUS_FREE && aligned_size - last->size < MMAP_THRESHOLD)
 		{
-			block = request_space_malloc(aligned_size - last->size);
-			if (!block)
-			{
-				return NULL;
-			}
-			last->size += block->size;
+			extend_heap(aligned_size - last->size);
+			last->size = aligned_size;
 			block = last;
 			if (block->size >= aligned_size + ALIGN(sizeof(block_meta) + ALIGN(1)))
 			{
 				split_block(block, aligned_size);
 			}
 			block->status = STATUS_ALLOC;
+			meta_update(block);
 			return (void *)block + ALIGN(sizeof(block_meta));
 		}
 		
@@ -267,6 +458,7 @@ void *os_malloc(size_t size)
 		{
 			//If the block is allocated with brk we add it to the end of the list
 			last->next = block;
+			meta_append(block);
 			if (last->status == STATUS_FREE)
 			{
 				//If the last block is free we coalesce it with the new block
@@ -288,15 +480,50 @@ void os_free(void *ptr)
 	}
 
 	block_meta *block = get_block_ptr(ptr);
+	//Arena blocks only go away with their arena
+	if (block->status == STATUS_ARENA)
+	{
+		return;
+	}
 	if (block->status == STATUS_ALLOC)
 	{
-		//If the block is allocated with brk we mark it as free
-		block->status = STATUS_FREE;
+		//If the block is allocated with brk we mark it as free, big ones may be zeroed first
+		if (!prezero_offer(block))
+		{
+			block->status = STATUS_FREE;
+			block->grows = 0;
+			meta_update(block);
+		}
+	}
+	else if (block->status == STATUS_HEAP)
+	{
+		//Blocks of an os_heap go back to their own heap
+		heap_free_block(block);
+	}
+	else if (block->status == STATUS_GROWABLE)
+	{
+		//Growable buffers give back their whole reservation
+		growable_release(block);
+	}
+	else if (block->status == STATUS_SHARED)
+	{
+		//Shareable blocks also close their memfd
+		shareable_release(block);
+	}
+	else if (block->status == STATUS_CLONED)
+	{
+		//Clones drop their reference to the shared memfd
+		clone_release(block);
+	}
+	else if (block->status == STATUS_RING)
+	{
+		//Rings unmap both of their views
+		ring_release(block);
 	}
 	else
 	{
 		//If the block is allocated with mmap we free it
-		int ret = munmap(block, block->size);
+		int ret = munmap(map_start(block), map_length(block));
 		DIE(ret == -1, "munmap");
 	}
 }
@@ -304,12 +531,35 @@ void os_free(void *ptr)
 void *os_calloc(size_t nmemb, size_t size)
 {
 	/* TODO: Implement os_calloc */
+	os_arena *arena = arena_current();
+	if (arena && nmemb && size)
+	{
+		void *ptr = os_arena_malloc(arena, nmemb * size);
+		if (ptr)
+		{
+			mem_zero(ptr, nmemb * size);
+		}
+		return ptr;
+	}
+	return direct_calloc(nmemb, size);
+}
+
+/**
+ * @brief os_calloc without the arena redirection
+ * 
+ * @param nmemb The number of elements
+ * @param size The size of an element
+ * @return void* The data pointer
+ */
+void *direct_calloc(size_t nmemb, size_t size)
+{
 	if (nmemb == 0 || size == 0)
 	{
 		return NULL;
 	}
 
 	size *= nmemb;
+	prezero_collect();
 
 	//Calculate the aligned size
 	int aligned_size = ALIGN(sizeof(block_meta)) + ALIGN(size);
@@ -323,8 +573,13 @@ void *os_calloc(size_t nmemb, size_t size)
 	Also save the last block in the list because we will need it later*/
 	block_meta *last = coalesce_blocks();
 	
-	//Find the best fit block
+	//Find the best fit block, taking back blocks queued for zeroing before the heap grows
 	block_meta *block = find_best_fit(aligned_size);
+	if (!block && prezero_reclaim())
+	{
+		last = coalesce_blocks();
+		block = find_best_fit(aligned_size);
+	}
 	if (block)
 	{
 		//If the block is bigger than the required size we split it
@@ -333,28 +588,31 @@ void *os_calloc(size_t nmemb, size_t size)
 			split_block(block, aligned_size);
 		}
 		block->status = STATUS_ALLOC;
-		//Set the memory to 0
-		memset((void *)block + ALIGN(sizeof(block_meta)), 0, size);
+		meta_update(block);
+		//Set the memory to 0, unless it was zeroed in the background
+		if (!take_zeroed(block))
+		{
+			mem_zero((void *)block + ALIGN(sizeof(block_meta)), size);
+		}
 		return (void *)block + ALIGN(sizeof(block_meta));
 	}
 	else
 	{
-		if (last && last->status == STATUS_FREE) /*If the last block is free we expand it*/
+		/*If the last block is free we expand it, as long as the missing part
+		would have come from the heap*/
+		if (last && last->status == STATUS_FREE && aligned_size - last->size < (size_t)sysconf(_SC_PAGESIZE))
 		{
-			block = request_space_calloc(aligned_size - last->size);
-			if (!block)
-			{
-				return NULL;
-			}
-			last->size += block->size;
+			extend_heap(aligned_size - last->size);
+			last->size = aligned_size;
 			block = last;
 			if (block->size >= aligned_size + ALIGN(sizeof(block_meta) + ALIGN(1)))
 			{
 				split_block(block, aligned_size);
 			}
 			block->status = STATUS_ALLOC;
+			meta_update(block);
 			//Set the memory to 0
-			memset((void *)block + ALIGN(sizeof(block_meta)), 0, size);
+			mem_zero((void *)block + ALIGN(sizeof(block_meta)), size);
 			return (void *)block + ALIGN(sizeof(block_meta));
 		}
 		
@@ -368,6 +626,7 @@ void *os_calloc(size_t nmemb, size_t size)
 		{
 			//If the block is allocated with brk we add it to the end of the list
 			last->next = block;
+			meta_append(block);
 			if (last->status == STATUS_FREE)
 			{
 				//If the last block is free we coalesce it with the new block
@@ -375,8 +634,11 @@ void *os_calloc(size_t nmemb, size_t size)
 				last->next = block->next;
 			}
 		}
-		//Set the memory to 0
-		memset((void *)block + ALIGN(sizeof(block_meta)), 0, size);
+		//Fresh mappings are already zeroed by the kernel
+		if (block->status != STATUS_MAPPED)
+		{
+			mem_zero((void *)block + ALIGN(sizeof(block_meta)), size);
+		}
 		return (void *)block + ALIGN(sizeof(block_meta));
 	}
 
@@ -410,18 +672,71 @@ void *os_realloc(void *ptr, size_t size)
 	}
 
 
+	//Blocks of an os_heap stay in their heap
+	if (block->status == STATUS_HEAP)
+	{
+		return heap_realloc_block(block, size);
+	}
+
+	//Shareable blocks resize their memfd so they stay shareable
+	if (block->status == STATUS_SHARED)
+	{
+		return shareable_realloc(block, size);
+	}
+
+	//Arena blocks grow into a new block, the old one stays in its arena
+	if (block->status == STATUS_ARENA)
+	{
+		return arena_realloc(block, size);
+	}
+
+	//Rings move to a ring of the new size
+	if (block->status == STATUS_RING)
+	{
+		return ring_realloc(block, size);
+	}
+
+	//Clones are private views of a file that cannot grow, they are copied out
+	if (block->status == STATUS_CLONED)
+	{
+		return realloc_move(ptr, size);
+	}
+
+	//Growable buffers resize inside their reservation and only move past it
+	if (block->status == STATUS_GROWABLE)
+	{
+		if (os_growable_resize(ptr, size) == 0)
+		{
+			return ptr;
+		}
+		return realloc_move(ptr, size);
+	}
+
+	//Blocks that are being grown keep their slack, others get a new target size
+	size_t target = aligned_size;
+	if (block->size >= aligned_size)
+	{
+		if (realloc_keep_slack(block, aligned_size))
+		{
+			return ptr;
+		}
+	}
+	else
+	{
+		target = realloc_target(block, aligned_size);
+	}
+
 	//If the block is allocated with mmap we can't expand it
 	if (block->status == STATUS_MAPPED)
 	{
-		void *new_ptr = os_malloc(size);
-		block_meta *new_block = get_block_ptr(new_ptr);
-		if (!new_ptr)
+#ifdef REALLOC_MREMAP
+		//Large to large is a page table update instead of a copy
+		if (target >= MMAP_THRESHOLD)
 		{
-			return NULL;
+			return realloc_remap(block, target);
 		}
-		memcpy(new_ptr, ptr, new_block->size - ALIGN(sizeof(block_meta)));
-		os_free(ptr);
-		return new_ptr;
+#endif
+		return realloc_move(ptr, target - ALIGN(sizeof(block_meta)));
 	}
 
 	//If the new size is smaller than the old one we truncate the block
@@ -437,28 +752,247 @@ void *os_realloc(void *ptr, size_t size)
 
 	coalesce_blocks();
 	
-	//Try to expand the block
+	//Try to expand the block, keeping up to the target size for later reallocs
 	block = realloc_expand(block, aligned_size);
+	if (!block && prezero_reclaim())
+	{
+		coalesce_blocks();
+		block = realloc_expand(get_block_ptr(ptr), aligned_size);
+	}
 	if (block)
 	{
 		//If the block is bigger than the required size we split it
-		if (block->size >= aligned_size + ALIGN(sizeof(block_meta) + ALIGN(1)))
+		if (block->size >= target + ALIGN(sizeof(block_meta) + ALIGN(1)))
 		{
-			split_block(block, aligned_size);
+			split_block(block, target);
 		}
 		return ptr;
 	}
 	else
 	{
+#ifdef REALLOC_MREMAP
+		//Heap blocks crossing the threshold move their pages to a mapping
+		if (target >= MMAP_THRESHOLD)
+		{
+			return realloc_promote(get_block_ptr(ptr), target);
+		}
+#endif
 		//If the block can't be expanded we allocate a new one and copy the data
-		void *new_ptr = os_malloc(size);
-		block_meta *new_block = get_block_ptr(new_ptr);
-		if (!new_ptr)
+		return realloc_move(ptr, target - ALIGN(sizeof(block_meta)));
+	}
+}
+
+void *os_realloc_hint(void *ptr, size_t size, size_t expected_max)
+{
+	if (size == 0 || expected_max < size)
+	{
+		return os_realloc(ptr, size);
+	}
+
+	//Provision for the expected size once, later reallocs up to it stay in place
+	void *new_ptr = os_realloc(ptr, expected_max);
+	if (new_ptr && get_block_ptr(new_ptr)->status != STATUS_GROWABLE)
+	{
+		get_block_ptr(new_ptr)->grows = REALLOC_GROW_HINTED;
+	}
+	return new_ptr;
+}
+
+/**
+ * @brief Take a block out of a free block, from the end closest
+ * to the hint
+ * 
+ * @param block The free block
+ * @param hint The address the block should be close to
+ * @param size The size of the block
+ * @return block_meta* The block to hand out
+ */
+static block_meta *carve_near(block_meta *block, void *hint, size_t size)
+{
+	if (block->size < size + ALIGN(sizeof(block_meta) + ALIGN(1)))
+	{
+		return block;
+	}
+	if ((void *)block > hint)
+	{
+		split_block(block, size);
+		return block;
+	}
+
+	split_block(block, block->size - size);
+	block_meta *tail = (void *)block + block->size;
+	tail->size = size;
+	tail->status = STATUS_FREE;
+	tail->grows = 0;
+	return tail;
+}
+
+void *os_malloc_near(void *hint, size_t size)
+{
+	if (!hint || size == 0)
+	{
+		return os_malloc(size);
+	}
+
+	block_meta *hint_block = get_block_ptr(hint);
+	if (hint_block->status == STATUS_HEAP)
+	{
+		return heap_malloc_near(hint_block, size);
+	}
+	if (hint_block->status != STATUS_ALLOC)
+	{
+		return os_malloc(size);
+	}
+
+	size_t aligned_size = ALIGN(sizeof(block_meta)) + ALIGN(size);
+	coalesce_blocks();
+#ifdef OOB_METADATA
+	block_meta *block = meta_near_fit(hint, aligned_size);
+#else
+	block_meta *block = list_near_fit(global_base, hint, aligned_size);
+#endif
+	if (!block)
+	{
+		//Nothing close enough, fall back to the best fit
+		return os_malloc(size);
+	}
+
+	block = carve_near(block, hint, aligned_size);
+	block->status = STATUS_ALLOC;
+	meta_update(block);
+	return (void *)block + ALIGN(sizeof(block_meta));
+}
+
+size_t os_malloc_usable_size(void *ptr)
+{
+	if (!ptr)
+	{
+		return 0;
+	}
+
+	block_meta *block = get_block_ptr(ptr);
+	if (block->status == STATUS_FREE)
+	{
+		return 0;
+	}
+	return block->size - ALIGN(sizeof(block_meta));
+}
+
+/**
+ * @brief Allocate several blocks next to each other with one fit search.
+ * One block big enough for all of them is split into pieces that are
+ * freed on their own
+ * 
+ * @param n The number of blocks
+ * @param sizes The sizes of the blocks, or NULL if they all have the same size
+ * @param size The size of every block when sizes is NULL
+ * @param ptrs The array filled with the blocks, allocated in front of them if NULL
+ * @return void** The array of blocks or NULL on failure
+ */
+static void **independent_alloc(size_t n, size_t *sizes, size_t size, void **ptrs)
+{
+	if (n == 0)
+	{
+		return NULL;
+	}
+
+	size_t total = ptrs ? 0 : ALIGN(sizeof(block_meta)) + ALIGN(n * sizeof(void *));
+	for (size_t i = 0; i < n; i++)
+	{
+		size_t piece_size = sizes ? sizes[i] : size;
+		total += ALIGN(sizeof(block_meta)) + ALIGN(piece_size ? piece_size : 1);
+	}
+
+	//Mapped blocks cannot be unmapped piece by piece, so big groups are separate blocks
+	if (total >= MMAP_THRESHOLD || arena_current())
+	{
+		ptrs = ptrs ? ptrs : os_malloc(n * sizeof(void *));
+		for (size_t i = 0; ptrs && i < n; i++)
 		{
-			return NULL;
+			size_t piece_size = sizes ? sizes[i] : size;
+			ptrs[i] = os_malloc(piece_size ? piece_size : 1);
+		}
+		return ptrs;
+	}
+
+	void *ptr = os_malloc(total - ALIGN(sizeof(block_meta)));
+	if (!ptr)
+	{
+		return NULL;
+	}
+	block_meta *block = get_block_ptr(ptr);
+
+	//Cut the pieces from the front, the last one keeps the slack
+	for (size_t i = ptrs ? 1 : 0; i <= n; i++)
+	{
+		size_t piece_size = i == 0 ? n * sizeof(void *) : (sizes ? sizes[i - 1] : size);
+		size_t aligned_size = ALIGN(sizeof(block_meta)) + ALIGN(piece_size ? piece_size : 1);
+		if (i == 0)
+		{
+			ptrs = (void *)block + ALIGN(sizeof(block_meta));
+		}
+		else
+		{
+			ptrs[i - 1] = (void *)block + ALIGN(sizeof(block_meta));
+		}
+		if (i == n)
+		{
+			break;
+		}
+
+		size_t rest = block->size - aligned_size;
+		split_block(block, aligned_size);
+		block = (void *)block + aligned_size;
+		block->size = rest;
+		block->status = STATUS_ALLOC;
+		block->grows = 0;
+		meta_update(block);
+	}
+	return ptrs;
+}
+
+void **os_independent_comalloc(size_t n, size_t *sizes, void **ptrs)
+{
+	return independent_alloc(n, sizes, 0, ptrs);
+}
+
+void **os_independent_calloc(size_t n, size_t size, void **ptrs)
+{
+	ptrs = independent_alloc(n, NULL, size, ptrs);
+	for (size_t i = 0; ptrs && i < n; i++)
+	{
+		if (ptrs[i])
+		{
+			mem_zero(ptrs[i], size);
+		}
+	}
+	return ptrs;
+}
+
+void os_stats(os_mem_stats *stats)
+{
+	if (!stats)
+	{
+		return;
+	}
+	memset(stats, 0, sizeof(*stats));
+
+#ifdef OOB_METADATA
+	meta_heap_stats(stats);
+#else
+	for (block_meta *current = global_base; current; current = current->next)
+	{
+		if (current->status == STATUS_FREE || current->status == STATUS_ZEROING)
+		{
+			stats->heap_free_blocks++;
+			stats->heap_free_bytes += current->size;
+		}
+		else
+		{
+			stats->heap_blocks++;
+			stats->heap_bytes += current->size;
 		}
-		memcpy(new_ptr, ptr, new_block->size - ALIGN(sizeof(block_meta)));
-		os_free(ptr);
-		return new_ptr;
 	}
+#endif
+	ring_stats(stats);
 }
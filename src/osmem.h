@@ -5,6 +5,7 @@
 #include <errno.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <unistd.h>
 #include "printf.h"
 
 //mmap threshold for os_malloc is 128 KB
@@ -20,3 +21,145 @@ void *os_malloc(size_t size);
 void os_free(void *ptr);
 void *os_calloc(size_t nmemb, size_t size);
 void *os_realloc(void *ptr, size_t size);
+
+void *os_realloc_hint(void *ptr, size_t size, size_t expected_max);
+void *os_malloc_near(void *hint, size_t size);
+size_t os_malloc_usable_size(void *ptr);
+
+/* Several blocks allocated next to each other, each freed with os_free */
+void **os_independent_comalloc(size_t n, size_t *sizes, void **ptrs);
+void **os_independent_calloc(size_t n, size_t size, void **ptrs);
+
+/* Blocks backed by a memfd that other processes can map, freed with os_free.
+The data starts at this offset in the file */
+#define OSMEM_SHAREABLE_OFFSET sysconf(_SC_PAGESIZE)
+
+void *os_malloc_shareable(size_t size, int *fd);
+
+/* Copy-on-write duplicate of a block, only pages written later are copied */
+void *os_clone(void *ptr);
+
+/* Ring buffer of at least size bytes, mapped twice back to back so that
+accesses of up to its size never wrap. Freed with os_free */
+void *os_malloc_ring(size_t size);
+size_t os_ring_size(void *ptr);
+
+/* Allocator statistics */
+typedef struct os_mem_stats {
+	size_t heap_blocks;			/* Blocks in use on the brk heap */
+	size_t heap_bytes;			/* Bytes of those blocks, headers included */
+	size_t heap_free_blocks;	/* Free blocks on the brk heap */
+	size_t heap_free_bytes;		/* Bytes of those blocks */
+	size_t ring_blocks;			/* Live ring buffers */
+	size_t ring_bytes;			/* Size of those rings, one view each */
+} os_mem_stats;
+
+void os_stats(os_mem_stats *stats);
+
+/* Buffers that grow in place inside a reservation of max_bytes */
+void *os_growable_create(size_t max_bytes);
+int os_growable_resize(void *ptr, size_t size);
+
+/* Independent heaps, destroying one unmaps all of its memory */
+typedef struct os_heap os_heap;
+
+os_heap *os_heap_create(void);
+void os_heap_destroy(os_heap *heap);
+void *os_heap_malloc(os_heap *heap, size_t size);
+void os_heap_free(os_heap *heap, void *ptr);
+void *os_heap_realloc(os_heap *heap, void *ptr, size_t size);
+
+/* Lifetime hints for os_malloc_flags, each class is placed in its own heap */
+#define OSMEM_SHORT_LIVED 0x1
+#define OSMEM_LONG_LIVED  0x2
+#define OSMEM_COLD        0x4
+
+void *os_malloc_flags(size_t size, unsigned int flags);
+
+/* One copy of an object per CPU, each on its own cache lines */
+void *os_malloc_percpu(size_t size);
+void os_free_percpu(void *ptr);
+void *os_percpu_ptr(void *ptr, int cpu);
+void *os_percpu_this(void *ptr);
+int os_percpu_cpus(void);
+
+/* Visit the copy of every CPU, e.g. to sum up per-CPU counters */
+#define os_percpu_for_each(cpu, copy, ptr) \
+	for (int cpu = 0; cpu < os_percpu_cpus() && ((copy) = os_percpu_ptr((ptr), cpu)); cpu++)
+
+/* Epoch based reclamation, blocks freed with os_free_deferred are only
+given back once no thread can still be reading them. Only entering and
+leaving an epoch is thread safe, os_free_deferred is serialised like os_free */
+void os_epoch_enter(void);
+void os_epoch_exit(void);
+void os_free_deferred(void *ptr);
+
+/* Heap on a memfd that several processes can map, blocks are passed
+between them as offsets */
+typedef struct os_shm_heap os_shm_heap;
+
+os_shm_heap *os_shm_create(size_t size, int *fd);
+os_shm_heap *os_shm_attach(int fd);
+void os_shm_detach(os_shm_heap *heap);
+void *os_shm_malloc(os_shm_heap *heap, size_t size);
+void os_shm_free(os_shm_heap *heap, void *ptr);
+size_t os_shm_offset(os_shm_heap *heap, void *ptr);
+void *os_shm_ptr(os_shm_heap *heap, size_t offset);
+void os_shm_set_root(os_shm_heap *heap, void *ptr);
+void *os_shm_root(os_shm_heap *heap);
+
+/* The same heap in a regular file, reopened with its blocks after a restart */
+os_shm_heap *os_pheap_open(const char *path, size_t size, void *base);
+void os_pheap_close(os_shm_heap *heap);
+
+/* Save the brk heap to a file and map it back in a fresh process */
+int os_heap_snapshot(const char *path);
+int os_heap_restore(const char *path);
+
+/* Page aligned buffers in page multiples for O_DIRECT and io_uring,
+recycled from a pre-faulted pool */
+void *os_iobuf_alloc(size_t size);
+void os_iobuf_free(void *ptr);
+void os_iobuf_mlock(int enable);
+
+/* Reference counted buffer, slices share its payload without copying and
+the payload is freed with the last slice */
+typedef struct os_buf {
+	void *data;
+	size_t len;
+	struct os_buf_backing *backing;
+} os_buf;
+
+os_buf *os_buf_alloc(size_t size);
+os_buf *os_buf_slice(os_buf *buf, size_t offset, size_t len);
+void os_buf_release(os_buf *buf);
+
+/* Per-thread LIFO scratch stack, everything allocated after a mark goes
+away when the stack is released to it */
+typedef struct os_scratch_pos {
+	void *chunk;
+	size_t used;
+} os_scratch_pos;
+
+os_scratch_pos os_scratch_mark(void);
+void *os_scratch_alloc(size_t size);
+void os_scratch_release(os_scratch_pos mark);
+
+/* Bump arenas, freed all at once. os_arena_push redirects os_malloc and
+os_calloc on the calling thread to an arena until os_arena_pop */
+typedef struct os_arena os_arena;
+
+os_arena *os_arena_create(void);
+void os_arena_reset(os_arena *arena);
+void os_arena_destroy(os_arena *arena);
+void *os_arena_malloc(os_arena *arena, size_t size);
+int os_arena_push(os_arena *arena);
+os_arena *os_arena_pop(void);
+
+/* Node-local allocation, blocks come from a heap bound to the NUMA node
+and are freed with os_free. Without NUMA there is a single node 0 */
+int os_numa_nodes(void);
+int os_numa_node(void);
+void *os_malloc_onnode(size_t size, int node);
+void *os_malloc_local(size_t size);
+int os_numa_stats(int node, os_mem_stats *stats);
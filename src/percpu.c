@@ -0,0 +1,80 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#define _GNU_SOURCE
+#include <sched.h>
+#include "osmem.h"
+#include "helpers.h"
+
+/*One zeroed copy of the object per possible CPU, each one starting on its
+own cache line, laid out back to back in a single block. The cache line
+before the first copy holds the bookkeeping*/
+typedef struct percpu_meta {
+	void *block;
+	size_t stride;
+} percpu_meta;
+
+static int percpu_cpus;
+
+
+int os_percpu_cpus(void)
+{
+	if (!percpu_cpus)
+	{
+		long cpus = sysconf(_SC_NPROCESSORS_CONF);
+		percpu_cpus = cpus > 0 ? cpus : 1;
+	}
+	return percpu_cpus;
+}
+
+static percpu_meta *get_percpu_meta(void *ptr)
+{
+	return (void *)ptr - CACHE_LINE_SIZE;
+}
+
+
+void *os_malloc_percpu(size_t size)
+{
+	if (size == 0)
+	{
+		return NULL;
+	}
+
+	size_t stride = (size + CACHE_LINE_SIZE - 1) & ~((size_t)CACHE_LINE_SIZE - 1);
+	size_t cpus = os_percpu_cpus();
+	//One line for the bookkeeping and one to align the first copy
+	void *block = direct_calloc(1, 2 * CACHE_LINE_SIZE + cpus * stride);
+	if (!block)
+	{
+		return NULL;
+	}
+
+	void *ptr = (void *)(((uintptr_t)block + 2 * CACHE_LINE_SIZE - 1) & ~((uintptr_t)CACHE_LINE_SIZE - 1));
+	percpu_meta *meta = get_percpu_meta(ptr);
+	meta->block = block;
+	meta->stride = stride;
+	return ptr;
+}
+
+void os_free_percpu(void *ptr)
+{
+	if (!ptr)
+	{
+		return;
+	}
+	os_free(get_percpu_meta(ptr)->block);
+}
+
+void *os_percpu_ptr(void *ptr, int cpu)
+{
+	if (!ptr || cpu < 0 || cpu >= os_percpu_cpus())
+	{
+		return NULL;
+	}
+	return ptr + cpu * get_percpu_meta(ptr)->stride;
+}
+
+void *os_percpu_this(void *ptr)
+{
+	int cpu = sched_getcpu();
+	return os_percpu_ptr(ptr, cpu < 0 ? 0 : cpu % os_percpu_cpus());
+}
@@ -0,0 +1,122 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "osmem.h"
+#include "helpers.h"
+
+/*The heap normally grows with brk. A restored snapshot, or the heap in the
+deterministic address mode, is a reserved range instead, and its end moves
+inside the reservation*/
+static void *reserved_break;
+static void *reserved_committed;
+static void *reserved_end;
+
+#ifdef DETERMINISTIC_ADDR
+/* Next address handed out to a mapping, mappings are never placed twice at the same spot */
+static void *map_cursor = (void *)DETERMINISTIC_MAP_BASE;
+#endif
+
+
+/**
+ * @brief Make a reserved range the heap, the pages up to committed are
+ * accessible and the end of the heap starts at brk
+ *
+ * @param brk The end of the heap
+ * @param committed The end of the accessible pages
+ * @param end The end of the reservation
+ */
+void heap_adopt(void *brk, void *committed, void *end)
+{
+	reserved_break = brk;
+	reserved_committed = committed;
+	reserved_end = end;
+}
+
+#ifdef DETERMINISTIC_ADDR
+/* Reserve the heap at its fixed base the first time it grows */
+static void heap_reserve_fixed(void)
+{
+	void *start = mmap((void *)DETERMINISTIC_HEAP_BASE, DETERMINISTIC_HEAP_RESERVE, PROT_NONE,
+					   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED_NOREPLACE, -1, 0);
+	DIE(start != (void *)DETERMINISTIC_HEAP_BASE, "mmap");
+	heap_adopt(start, start, start + DETERMINISTIC_HEAP_RESERVE);
+}
+#endif
+
+/**
+ * @brief sbrk for the heap, moves the end of a reserved heap inside its
+ * reservation and the program break otherwise
+ *
+ * @param increment The number of bytes to add
+ * @return void* The previous end of the heap or (void *)-1
+ */
+void *heap_sbrk(intptr_t increment)
+{
+#ifdef DETERMINISTIC_ADDR
+	if (!reserved_break)
+	{
+		heap_reserve_fixed();
+	}
+#endif
+	if (!reserved_break)
+	{
+		return sbrk(increment);
+	}
+
+	void *old_break = reserved_break;
+	void *new_break = old_break + increment;
+	if (new_break > reserved_end)
+	{
+		errno = ENOMEM;
+		return (void *)-1;
+	}
+	if (new_break > reserved_committed)
+	{
+		size_t page_size = sysconf(_SC_PAGESIZE);
+		void *committed = (void *)(((uintptr_t)new_break + page_size - 1) & ~((uintptr_t)page_size - 1));
+		if (mprotect(reserved_committed, committed - reserved_committed, PROT_READ | PROT_WRITE) == -1)
+		{
+			return (void *)-1;
+		}
+		reserved_committed = committed;
+	}
+	reserved_break = new_break;
+	return old_break;
+}
+
+/**
+ * @brief mmap for blocks, at an address picked by the kernel or, in the
+ * deterministic address mode, at the next free address after the previous
+ * mapping
+ *
+ * @return void* The mapping or MAP_FAILED
+ */
+void *map_pages(size_t length, int prot, int flags, int fd, off_t offset)
+{
+#ifdef DETERMINISTIC_ADDR
+	size_t page_size = sysconf(_SC_PAGESIZE);
+	size_t mapped = (length + page_size - 1) & ~(page_size - 1);
+	//Skip over ranges that are taken, older kernels ignore the flag and map elsewhere
+	for (int attempt = 0; attempt < 64; attempt++)
+	{
+		void *hint = map_cursor;
+		map_cursor += mapped + page_size;
+		void *start = mmap(hint, length, prot, flags | MAP_FIXED_NOREPLACE, fd, offset);
+		if (start == hint)
+		{
+			return start;
+		}
+		if (start != MAP_FAILED)
+		{
+			munmap(start, length);
+		}
+		else if (errno != EEXIST)
+		{
+			return MAP_FAILED;
+		}
+	}
+	errno = ENOMEM;
+	return MAP_FAILED;
+#else
+	return mmap(NULL, length, prot, flags, fd, offset);
+#endif
+}
@@ -0,0 +1,247 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include "osmem.h"
+#include "helpers.h"
+
+#ifdef PREZERO
+
+/*Big blocks freed on the heap are handed to a background thread instead of
+being marked free. Only the allocating threads touch block headers: a
+queued block is STATUS_ZEROING, so no fit search or merge looks at it, and
+the thread only writes its payload. Zeroed blocks come back through a
+second queue and are marked free and known-zero on the next allocation.
+At most PREZERO_MAX_BYTES are away at once, and blocks the thread has not
+started on are taken back unzeroed when the heap would otherwise grow.
+The thread does not survive fork, so the child takes every block back*/
+typedef struct zero_queue {
+	block_meta *blocks[PREZERO_QUEUE];
+	size_t head;
+	size_t count;
+} zero_queue;
+
+static zero_queue pending;
+static zero_queue done;
+static block_meta *zeroing;
+static atomic_size_t done_count;
+static atomic_size_t queued_bytes;
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_cond = PTHREAD_COND_INITIALIZER;
+static pthread_once_t worker_once = PTHREAD_ONCE_INIT;
+static int fork_handlers;
+
+
+static void queue_push(zero_queue *queue, block_meta *block)
+{
+	queue->blocks[(queue->head + queue->count) % PREZERO_QUEUE] = block;
+	queue->count++;
+}
+
+static block_meta *queue_pop(zero_queue *queue)
+{
+	block_meta *block = queue->blocks[queue->head];
+	queue->head = (queue->head + 1) % PREZERO_QUEUE;
+	queue->count--;
+	return block;
+}
+
+/**
+ * @brief Give a block that was away back to the heap as a free block
+ *
+ * @param block The block
+ * @param zeroed 1 if the thread zeroed its payload
+ */
+static void queue_return(block_meta *block, int zeroed)
+{
+	block->status = STATUS_FREE;
+	block->grows = zeroed ? BLOCK_ZEROED : 0;
+	meta_update(block);
+	atomic_fetch_sub(&queued_bytes, block->size);
+}
+
+/**
+ * @brief Zero the payload of a block. Whole pages are dropped so they come
+ * back as fresh zero pages, only the edges are written
+ *
+ * @param block The block
+ */
+static void zero_block(block_meta *block)
+{
+	size_t page_size = sysconf(_SC_PAGESIZE);
+	void *start = (void *)block + ALIGN(sizeof(block_meta));
+	void *end = (void *)block + block->size;
+	void *first = (void *)(((uintptr_t)start + page_size - 1) & ~((uintptr_t)page_size - 1));
+	void *last = (void *)((uintptr_t)end & ~((uintptr_t)page_size - 1));
+
+	if (last > first && madvise(first, last - first, MADV_DONTNEED) == 0)
+	{
+		memset(start, 0, first - start);
+		memset(last, 0, end - last);
+		return;
+	}
+	memset(start, 0, end - start);
+}
+
+static void *zero_worker(void *arg)
+{
+	(void)arg;
+	//Only run when nothing else wants the CPU
+	struct sched_param param = {0};
+	pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+
+	pthread_mutex_lock(&queue_lock);
+	while (1)
+	{
+		while (!pending.count || done.count == PREZERO_QUEUE)
+		{
+			pthread_cond_wait(&queue_cond, &queue_lock);
+		}
+		block_meta *block = queue_pop(&pending);
+		zeroing = block;
+		pthread_mutex_unlock(&queue_lock);
+
+		zero_block(block);
+
+		pthread_mutex_lock(&queue_lock);
+		zeroing = NULL;
+		queue_push(&done, block);
+		atomic_store(&done_count, done.count);
+	}
+	return NULL;
+}
+
+static void fork_prepare(void)
+{
+	pthread_mutex_lock(&queue_lock);
+}
+
+static void fork_parent(void)
+{
+	pthread_mutex_unlock(&queue_lock);
+}
+
+/**
+ * @brief Only the forking thread lives on in the child. Take back every
+ * block the zeroing thread had, including the one it was working on, and
+ * let the next offer start a new thread
+ *
+ */
+static void fork_child(void)
+{
+	static const pthread_once_t once_init = PTHREAD_ONCE_INIT;
+
+	while (pending.count)
+	{
+		queue_return(queue_pop(&pending), 0);
+	}
+	if (zeroing)
+	{
+		queue_return(zeroing, 0);
+		zeroing = NULL;
+	}
+	while (done.count)
+	{
+		queue_return(queue_pop(&done), 1);
+	}
+	atomic_store(&done_count, 0);
+	memcpy(&worker_once, &once_init, sizeof(worker_once));
+	pthread_cond_init(&queue_cond, NULL);
+	pthread_mutex_unlock(&queue_lock);
+}
+
+static void start_worker(void)
+{
+	if (!fork_handlers)
+	{
+		int ret = pthread_atfork(fork_prepare, fork_parent, fork_child);
+		DIE(ret != 0, "pthread_atfork");
+		fork_handlers = 1;
+	}
+
+	pthread_t worker;
+	int ret = pthread_create(&worker, NULL, zero_worker, NULL);
+	DIE(ret != 0, "pthread_create");
+	pthread_detach(worker);
+}
+
+
+/**
+ * @brief Hand a block that is being freed to the zeroing thread
+ *
+ * @param block The block
+ * @return int 1 if the thread took the block, 0 if it has to be freed as usual
+ */
+int prezero_offer(block_meta *block)
+{
+	if (block->size < PREZERO_MIN_SIZE)
+	{
+		return 0;
+	}
+	pthread_once(&worker_once, start_worker);
+
+	pthread_mutex_lock(&queue_lock);
+	if (pending.count == PREZERO_QUEUE ||
+		atomic_load_explicit(&queued_bytes, memory_order_relaxed) + block->size > PREZERO_MAX_BYTES)
+	{
+		pthread_mutex_unlock(&queue_lock);
+		return 0;
+	}
+	block->status = STATUS_ZEROING;
+	block->grows = 0;
+	meta_update(block);
+	queue_push(&pending, block);
+	atomic_fetch_add(&queued_bytes, block->size);
+	pthread_cond_signal(&queue_cond);
+	pthread_mutex_unlock(&queue_lock);
+	return 1;
+}
+
+/**
+ * @brief Mark the blocks the thread zeroed as free and known-zero
+ *
+ */
+void prezero_collect(void)
+{
+	if (!atomic_load_explicit(&done_count, memory_order_relaxed))
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&queue_lock);
+	while (done.count)
+	{
+		queue_return(queue_pop(&done), 1);
+	}
+	atomic_store(&done_count, 0);
+	pthread_cond_signal(&queue_cond);
+	pthread_mutex_unlock(&queue_lock);
+}
+
+/**
+ * @brief Take back the blocks still waiting for the thread, unzeroed, and
+ * collect the zeroed ones. Called before the heap grows
+ *
+ * @return int 1 if any block became free
+ */
+int prezero_reclaim(void)
+{
+	if (!atomic_load_explicit(&queued_bytes, memory_order_relaxed))
+	{
+		return 0;
+	}
+
+	pthread_mutex_lock(&queue_lock);
+	int reclaimed = pending.count || done.count;
+	while (pending.count)
+	{
+		queue_return(queue_pop(&pending), 0);
+	}
+	pthread_mutex_unlock(&queue_lock);
+	prezero_collect();
+	return reclaimed;
+}
+
+#endif
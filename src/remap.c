@@ -0,0 +1,99 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#define _GNU_SOURCE
+#include "osmem.h"
+#include "helpers.h"
+
+static size_t page_round(size_t size, size_t page_size)
+{
+	return (size + page_size - 1) & ~(page_size - 1);
+}
+
+
+/**
+ * @brief Resize a mapped block with mremap. If the mapping can't grow in
+ * place the kernel moves its page table entries, the payload is never copied
+ * 
+ * @param block The mapped block
+ * @param size The new size of the block
+ * @return void* The new data pointer or NULL if the remap failed
+ */
+void *realloc_remap(block_meta *block, size_t size)
+{
+	size_t page_size = sysconf(_SC_PAGESIZE);
+	void *start = map_start(block);
+	size_t offset = (void *)block - start;
+	size_t length = page_round(offset + size, page_size);
+
+	void *new_start = mremap(start, map_length(block), length, MREMAP_MAYMOVE);
+	if (new_start == MAP_FAILED)
+	{
+		return NULL;
+	}
+
+	block = new_start + offset;
+	block->size = length - offset;
+	return (void *)block + ALIGN(sizeof(block_meta));
+}
+
+
+/**
+ * @brief Move a heap block that grew past MMAP_THRESHOLD into its own mapping.
+ * The pages holding the header and the payload are moved with mremap and
+ * grown in the same call, so the payload keeps its offset inside the page and
+ * the new mapping is a single area that later remaps can resize. Only the
+ * partial last page and the bytes of the first page that belong to the
+ * previous heap blocks are copied. The heap gets fresh pages in place of the
+ * moved ones and the old block is freed
+ * 
+ * @param block The heap block
+ * @param size The new size of the block
+ * @return void* The new data pointer
+ */
+void *realloc_promote(block_meta *block, size_t size)
+{
+	size_t page_size = sysconf(_SC_PAGESIZE);
+	void *ptr = (void *)block + ALIGN(sizeof(block_meta));
+	size_t payload = block->size - ALIGN(sizeof(block_meta));
+	void *first = map_start(block);
+	void *last = (void *)(((uintptr_t)ptr + payload) & ~(page_size - 1));
+	size_t offset = (void *)block - first;
+	size_t length = page_round(offset + size, page_size);
+
+	void *start = map_pages(length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	DIE(start == MAP_FAILED, "mmap");
+
+	void *moved = MAP_FAILED;
+	if (last > first)
+	{
+		moved = mremap(first, last - first, length, MREMAP_MAYMOVE | MREMAP_FIXED, start);
+	}
+	if (moved != MAP_FAILED)
+	{
+		void *refill = mmap(first, last - first, PROT_READ | PROT_WRITE,
+							MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+		DIE(refill == MAP_FAILED, "mmap");
+
+		//Give the heap back the start of the first page, up to the old header
+		mem_copy(first, start, offset + ALIGN(sizeof(block_meta)));
+		mem_copy(start + (last - first), last, ptr + payload - last);
+	}
+	else
+	{
+		/*Nothing to move, or the pages span several areas of the heap. A failed
+		MREMAP_FIXED may have already unmapped the target, so map it again*/
+		start = mmap(start, length, PROT_READ | PROT_WRITE,
+					 MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+		DIE(start == MAP_FAILED, "mmap");
+		mem_copy(start + offset, block, ALIGN(sizeof(block_meta)) + payload);
+	}
+
+	block->status = STATUS_FREE;
+	block->grows = 0;
+	meta_update(block);
+	block = start + offset;
+	block->size = length - offset;
+	block->status = STATUS_MAPPED;
+	block->next = NULL;
+	return (void *)block + ALIGN(sizeof(block_meta));
+}
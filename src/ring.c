@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#define _GNU_SOURCE
+#include "osmem.h"
+#include "helpers.h"
+
+/*A ring of n bytes is one header page followed by the same memfd mapped
+twice back to back, so ptr[i] and ptr[i + n] are the same byte. The header
+sits at the end of the first page, right before the data*/
+typedef struct ring_meta {
+	size_t ring_size;
+	block_meta meta;
+} ring_meta;
+
+static size_t ring_blocks;
+static size_t ring_bytes;
+
+static ring_meta *get_ring(block_meta *block)
+{
+	return (ring_meta *)((void *)block - offsetof(ring_meta, meta));
+}
+
+
+void *os_malloc_ring(size_t size)
+{
+	if (size == 0)
+	{
+		return NULL;
+	}
+
+	size_t page_size = sysconf(_SC_PAGESIZE);
+	size = (size + page_size - 1) & ~(page_size - 1);
+	int fd = memfd_create("osmem-ring", MFD_CLOEXEC);
+	DIE(fd == -1, "memfd_create");
+	int ret = ftruncate(fd, size);
+	DIE(ret == -1, "ftruncate");
+
+	//Reserve the whole range first so both views land next to each other
+	void *start = map_pages(page_size + 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	DIE(start == MAP_FAILED, "mmap");
+	void *header = mmap(start, page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+	DIE(header == MAP_FAILED, "mmap");
+	void *data = start + page_size;
+	for (int view = 0; view < 2; view++)
+	{
+		void *mapped = mmap(data + view * size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+		DIE(mapped == MAP_FAILED, "mmap");
+	}
+	//The mappings keep the file alive
+	ret = close(fd);
+	DIE(ret == -1, "close");
+
+	ring_meta *ring = data - ALIGN(sizeof(block_meta)) - offsetof(ring_meta, meta);
+	ring->ring_size = size;
+	ring->meta.size = size + ALIGN(sizeof(block_meta));
+	ring->meta.status = STATUS_RING;
+	ring->meta.grows = 0;
+	ring->meta.next = NULL;
+
+	ring_blocks++;
+	ring_bytes += size;
+	return data;
+}
+
+size_t os_ring_size(void *ptr)
+{
+	block_meta *block = get_block_ptr(ptr);
+	if (block->status != STATUS_RING)
+	{
+		return 0;
+	}
+	return get_ring(block)->ring_size;
+}
+
+/**
+ * @brief Move a ring to a new ring of another size, keeping the start of
+ * its data
+ *
+ * @param block The ring block
+ * @param size The new size of the ring
+ * @return void* The new ring
+ */
+void *ring_realloc(block_meta *block, size_t size)
+{
+	void *ptr = (void *)block + ALIGN(sizeof(block_meta));
+	size_t old_size = get_ring(block)->ring_size;
+	void *new_ptr = os_malloc_ring(size);
+	if (!new_ptr)
+	{
+		return NULL;
+	}
+	size_t new_size = get_ring(get_block_ptr(new_ptr))->ring_size;
+	mem_copy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+	ring_release(block);
+	return new_ptr;
+}
+
+/**
+ * @brief Unmap a ring, its header page and both views
+ *
+ * @param block The ring block
+ */
+void ring_release(block_meta *block)
+{
+	size_t size = get_ring(block)->ring_size;
+	int ret = munmap(map_start(block), sysconf(_SC_PAGESIZE) + 2 * size);
+	DIE(ret == -1, "munmap");
+
+	ring_blocks--;
+	ring_bytes -= size;
+}
+
+/* Add the live rings to the allocator stats */
+void ring_stats(os_mem_stats *stats)
+{
+	stats->ring_blocks = ring_blocks;
+	stats->ring_bytes = ring_bytes;
+}
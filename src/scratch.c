@@ -0,0 +1,95 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "osmem.h"
+#include "helpers.h"
+
+/*Each thread bumps a pointer through a chain of chunks taken from the
+heap. A mark is the chunk and offset at the time, releasing to it drops
+every chunk pushed since. The last chunk dropped is kept as a spare so
+code working at a chunk boundary does not allocate on every push*/
+typedef struct scratch_chunk {
+	struct scratch_chunk *prev;
+	size_t capacity;
+} scratch_chunk;
+
+static __thread scratch_chunk *scratch_top;
+static __thread size_t scratch_used;
+static __thread scratch_chunk *scratch_spare;
+
+
+static void *chunk_data(scratch_chunk *chunk)
+{
+	return (void *)chunk + ALIGN(sizeof(scratch_chunk));
+}
+
+/* Start a new chunk with room for at least size bytes */
+static int scratch_grow(size_t size)
+{
+	scratch_chunk *chunk = scratch_spare;
+	if (chunk && chunk->capacity >= size)
+	{
+		scratch_spare = NULL;
+	}
+	else
+	{
+		size_t capacity = size > SCRATCH_CHUNK_SIZE ? size : SCRATCH_CHUNK_SIZE;
+		chunk = direct_malloc(ALIGN(sizeof(scratch_chunk)) + capacity);
+		if (!chunk)
+		{
+			return -1;
+		}
+		chunk->capacity = capacity;
+	}
+
+	chunk->prev = scratch_top;
+	scratch_top = chunk;
+	scratch_used = 0;
+	return 0;
+}
+
+
+os_scratch_pos os_scratch_mark(void)
+{
+	os_scratch_pos mark = {scratch_top, scratch_used};
+	return mark;
+}
+
+void *os_scratch_alloc(size_t size)
+{
+	if (size == 0)
+	{
+		return NULL;
+	}
+
+	size = ALIGN(size);
+	if (!scratch_top || scratch_top->capacity - scratch_used < size)
+	{
+		if (scratch_grow(size) == -1)
+		{
+			return NULL;
+		}
+	}
+	void *ptr = chunk_data(scratch_top) + scratch_used;
+	scratch_used += size;
+	return ptr;
+}
+
+void os_scratch_release(os_scratch_pos mark)
+{
+	while (scratch_top != mark.chunk)
+	{
+		MISUSE(!scratch_top, "os_scratch_release: mark not on this thread");
+		scratch_chunk *chunk = scratch_top;
+		scratch_top = chunk->prev;
+		if (!scratch_spare || chunk->capacity > scratch_spare->capacity)
+		{
+			os_free(scratch_spare);
+			scratch_spare = chunk;
+		}
+		else
+		{
+			os_free(chunk);
+		}
+	}
+	scratch_used = mark.used;
+}
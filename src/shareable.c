@@ -0,0 +1,120 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#define _GNU_SOURCE
+#include "osmem.h"
+#include "helpers.h"
+
+/*Shareable blocks keep their memfd and mapping length right before the
+header, at the end of the first page of the file. The payload starts on the
+second page, so other processes map the fd at offset OSMEM_SHAREABLE_OFFSET
+and find the data at the start of their mapping*/
+typedef struct shareable_meta {
+	size_t length;
+	int fd;
+	block_meta meta;
+} shareable_meta;
+
+static size_t page_round(size_t size)
+{
+	size_t page_size = sysconf(_SC_PAGESIZE);
+	return (size + page_size - 1) & ~(page_size - 1);
+}
+
+static shareable_meta *get_shareable(block_meta *block)
+{
+	return (shareable_meta *)((void *)block - offsetof(shareable_meta, meta));
+}
+
+static void *shareable_start(shareable_meta *shareable)
+{
+	return (void *)((uintptr_t)shareable & ~((uintptr_t)sysconf(_SC_PAGESIZE) - 1));
+}
+
+/* Place the header so that the payload starts on the second page */
+static shareable_meta *shareable_place(void *start)
+{
+	return start + sysconf(_SC_PAGESIZE) - ALIGN(sizeof(block_meta)) - offsetof(shareable_meta, meta);
+}
+
+
+void *os_malloc_shareable(size_t size, int *fd)
+{
+	if (size == 0 || !fd)
+	{
+		return NULL;
+	}
+
+	size_t length = sysconf(_SC_PAGESIZE) + page_round(size);
+	int memfd = memfd_create("osmem-shareable", 0);
+	DIE(memfd == -1, "memfd_create");
+	int ret = ftruncate(memfd, length);
+	DIE(ret == -1, "ftruncate");
+
+	void *start = map_pages(length, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+	DIE(start == MAP_FAILED, "mmap");
+	shareable_meta *shareable = shareable_place(start);
+	shareable->length = length;
+	shareable->fd = memfd;
+	shareable->meta.size = length - ((void *)&shareable->meta - start);
+	shareable->meta.status = STATUS_SHARED;
+	shareable->meta.grows = 0;
+	shareable->meta.next = NULL;
+
+	*fd = memfd;
+	return (void *)&shareable->meta + ALIGN(sizeof(block_meta));
+}
+
+/**
+ * @brief Resize the memfd of a shareable block and its mapping, the block
+ * stays shareable and keeps its descriptor
+ *
+ * @param block The shareable block
+ * @param size The new size of the payload
+ * @return void* The new data pointer
+ */
+void *shareable_realloc(block_meta *block, size_t size)
+{
+	shareable_meta *shareable = get_shareable(block);
+	void *start = shareable_start(shareable);
+	size_t length = sysconf(_SC_PAGESIZE) + page_round(size);
+	if (length == shareable->length)
+	{
+		return (void *)block + ALIGN(sizeof(block_meta));
+	}
+
+	//Grow the file before the mapping and shrink it after
+	int ret;
+	if (length > shareable->length)
+	{
+		ret = ftruncate(shareable->fd, length);
+		DIE(ret == -1, "ftruncate");
+	}
+	start = mremap(start, shareable->length, length, MREMAP_MAYMOVE);
+	DIE(start == MAP_FAILED, "mremap");
+	shareable_meta *moved = shareable_place(start);
+	if (length < moved->length)
+	{
+		ret = ftruncate(moved->fd, length);
+		DIE(ret == -1, "ftruncate");
+	}
+
+	moved->length = length;
+	moved->meta.size = length - ((void *)&moved->meta - start);
+	return (void *)&moved->meta + ALIGN(sizeof(block_meta));
+}
+
+/**
+ * @brief Unmap a shareable block and close its descriptor, mappings made by
+ * other processes stay valid
+ *
+ * @param block The shareable block
+ */
+void shareable_release(block_meta *block)
+{
+	shareable_meta *shareable = get_shareable(block);
+	int fd = shareable->fd;
+	int ret = munmap(shareable_start(shareable), shareable->length);
+	DIE(ret == -1, "munmap");
+	ret = close(fd);
+	DIE(ret == -1, "close");
+}
@@ -0,0 +1,438 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include "osmem.h"
+#include "helpers.h"
+
+#define SHM_MAGIC 0x6f73686d68656170UL
+
+/*Every process maps the heap at its own address, so blocks are linked by
+their offset from the start of the mapping, 0 ending the list. Same layout
+as block_meta otherwise*/
+typedef struct shm_block {
+	size_t size;
+	int status;
+	int unused;
+	size_t next;
+} shm_block;
+
+struct os_shm_heap {
+	unsigned long magic;
+	size_t size;
+	pthread_mutex_t lock;
+	size_t first;
+	size_t root;
+};
+
+static shm_block *shm_at(os_shm_heap *heap, size_t offset)
+{
+	return offset ? (void *)heap + offset : NULL;
+}
+
+static size_t shm_offset(os_shm_heap *heap, shm_block *block)
+{
+	return (void *)block - (void *)heap;
+}
+
+static int shm_check(os_shm_heap *heap, size_t size);
+
+/**
+ * @brief Finish a merge or split cut short by a process that died holding
+ * the lock. Both write the link of a block before its size, so when the two
+ * disagree the link is the new state and the size is fixed from it
+ *
+ * @param heap The heap
+ * @return int 0 if the block list is sound again, -1 otherwise
+ */
+static int shm_repair(os_shm_heap *heap)
+{
+	size_t offset = heap->first;
+	while (offset && offset + ALIGN(sizeof(shm_block)) <= heap->size)
+	{
+		shm_block *block = shm_at(heap, offset);
+		size_t end = block->next ? block->next : heap->size;
+		if (end <= offset || end > heap->size || end - offset < ALIGN(sizeof(shm_block)) ||
+			(end - offset) % ALIGNMENT)
+		{
+			return -1;
+		}
+		block->size = end - offset;
+		offset = block->next;
+	}
+	return shm_check(heap, heap->size);
+}
+
+/**
+ * @brief Take the heap lock. If its owner died, the block list is repaired
+ * before the lock is recovered. A list that cannot be repaired leaves the
+ * lock unrecoverable, so every later call fails instead of using it
+ *
+ * @param heap The heap
+ * @return int 0 on success, -1 with errno set to ENOTRECOVERABLE otherwise
+ */
+static int shm_lock(os_shm_heap *heap)
+{
+	int ret = pthread_mutex_lock(&heap->lock);
+	if (ret == EOWNERDEAD)
+	{
+		if (shm_repair(heap) == -1)
+		{
+			ret = pthread_mutex_unlock(&heap->lock);
+			DIE(ret != 0, "pthread_mutex_unlock");
+			errno = ENOTRECOVERABLE;
+			return -1;
+		}
+		ret = pthread_mutex_consistent(&heap->lock);
+	}
+	if (ret == ENOTRECOVERABLE)
+	{
+		errno = ret;
+		return -1;
+	}
+	DIE(ret != 0, "pthread_mutex_lock");
+	return 0;
+}
+
+static void shm_unlock(os_shm_heap *heap)
+{
+	//pthread calls return their error instead of setting errno
+	errno = pthread_mutex_unlock(&heap->lock);
+	DIE(errno != 0, "pthread_mutex_unlock");
+}
+
+/* Merge every run of free blocks, link first so shm_repair can finish it */
+static void shm_coalesce(os_shm_heap *heap)
+{
+	shm_block *current = shm_at(heap, heap->first);
+	while (current)
+	{
+		shm_block *next = shm_at(heap, current->next);
+		if (next && current->status == STATUS_FREE && next->status == STATUS_FREE)
+		{
+			current->next = next->next;
+			current->size += next->size;
+			continue;
+		}
+		current = next;
+	}
+}
+
+
+/* Size of the file holding a heap with room for size bytes */
+static size_t shm_file_size(size_t size)
+{
+	size_t page_size = sysconf(_SC_PAGESIZE);
+	return (ALIGN(sizeof(os_shm_heap)) + ALIGN(size) + ALIGN(sizeof(shm_block)) + page_size - 1) & ~(page_size - 1);
+}
+
+/* The lock is process-shared and robust, and only ever initialised with a new heap */
+static void shm_init_lock(os_shm_heap *heap)
+{
+	pthread_mutexattr_t attr;
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+	pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+	int ret = pthread_mutex_init(&heap->lock, &attr);
+	DIE(ret != 0, "pthread_mutex_init");
+	pthread_mutexattr_destroy(&attr);
+}
+
+/* Lay out an empty heap over a fresh mapping */
+static void shm_init(os_shm_heap *heap, size_t size)
+{
+	shm_init_lock(heap);
+	heap->size = size;
+	heap->first = ALIGN(sizeof(os_shm_heap));
+	heap->root = 0;
+	shm_block *block = shm_at(heap, heap->first);
+	block->size = size - heap->first;
+	block->status = STATUS_FREE;
+	block->next = 0;
+	heap->magic = SHM_MAGIC;
+}
+
+/**
+ * @brief Check that a mapped heap is one of ours and that its block list
+ * is sound: links go forward, blocks are contiguous and cover the whole
+ * file, statuses are known and the root is an allocated block
+ *
+ * @param heap The heap
+ * @param size The size of the file
+ * @return int 0 if the heap is consistent, -1 otherwise
+ */
+static int shm_check(os_shm_heap *heap, size_t size)
+{
+	if (heap->magic != SHM_MAGIC || heap->size != size || heap->first != ALIGN(sizeof(os_shm_heap)))
+	{
+		return -1;
+	}
+
+	int root_found = !heap->root;
+	size_t offset = heap->first;
+	while (offset)
+	{
+		if (offset + ALIGN(sizeof(shm_block)) > size)
+		{
+			return -1;
+		}
+		shm_block *block = shm_at(heap, offset);
+		if (block->size < ALIGN(sizeof(shm_block)) || block->size > size - offset ||
+			(block->status != STATUS_FREE && block->status != STATUS_ALLOC))
+		{
+			return -1;
+		}
+		if (heap->root == offset + ALIGN(sizeof(shm_block)) && block->status == STATUS_ALLOC)
+		{
+			root_found = 1;
+		}
+		if (block->next && block->next != offset + block->size)
+		{
+			return -1;
+		}
+		if (!block->next && offset + block->size != size)
+		{
+			return -1;
+		}
+		offset = block->next;
+	}
+	return root_found ? 0 : -1;
+}
+
+
+os_shm_heap *os_shm_create(size_t size, int *fd)
+{
+	if (size == 0 || !fd)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	size = shm_file_size(size);
+	*fd = memfd_create("osmem-shm", 0);
+	DIE(*fd == -1, "memfd_create");
+	int ret = ftruncate(*fd, size);
+	DIE(ret == -1, "ftruncate");
+	os_shm_heap *heap = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, *fd, 0);
+	DIE(heap == MAP_FAILED, "mmap");
+
+	shm_init(heap, size);
+	return heap;
+}
+
+os_shm_heap *os_pheap_open(const char *path, size_t size, void *base)
+{
+	if (!path)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+	if (fd == -1)
+	{
+		return NULL;
+	}
+	//Held until a new heap is laid out, so only one process creates it
+	int ret = flock(fd, LOCK_EX);
+	DIE(ret == -1, "flock");
+	struct stat st;
+	ret = fstat(fd, &st);
+	DIE(ret == -1, "fstat");
+
+	//A new file gets an empty heap, an existing one keeps its size
+	int created = st.st_size == 0;
+	if (created)
+	{
+		if (size == 0)
+		{
+			close(fd);
+			errno = EINVAL;
+			return NULL;
+		}
+		st.st_size = shm_file_size(size);
+		ret = ftruncate(fd, st.st_size);
+		DIE(ret == -1, "ftruncate");
+	}
+
+	//Blocks are linked by offset, so a base is only a preference
+	int flags = MAP_SHARED;
+	if (base)
+	{
+		flags |= MAP_FIXED_NOREPLACE;
+	}
+	os_shm_heap *heap = mmap(base, st.st_size, PROT_READ | PROT_WRITE, flags, fd, 0);
+	if (heap == MAP_FAILED && base)
+	{
+		heap = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	}
+	DIE(heap == MAP_FAILED, "mmap");
+	if (created)
+	{
+		shm_init(heap, st.st_size);
+	}
+	//The mapping keeps the file open, so close alone would not drop the flock
+	ret = flock(fd, LOCK_UN);
+	DIE(ret == -1, "flock");
+	ret = close(fd);
+	DIE(ret == -1, "close");
+	if (created)
+	{
+		return heap;
+	}
+
+	/*Another process may have the heap open and hold its lock, so the lock
+	is used as it is, and a dead owner is recovered by shm_lock. The header
+	never changes after creation and is checked before the lock is touched*/
+	int err = EINVAL;
+	if (heap->magic == SHM_MAGIC && heap->size == (size_t)st.st_size)
+	{
+		if (shm_lock(heap) == 0)
+		{
+			err = shm_check(heap, st.st_size) == -1 ? EINVAL : 0;
+			shm_unlock(heap);
+		}
+		else
+		{
+			err = errno;
+		}
+	}
+	if (err)
+	{
+		ret = munmap(heap, st.st_size);
+		DIE(ret == -1, "munmap");
+		errno = err;
+		return NULL;
+	}
+	return heap;
+}
+
+void os_pheap_close(os_shm_heap *heap)
+{
+	if (!heap)
+	{
+		return;
+	}
+	int ret = msync(heap, heap->size, MS_SYNC);
+	DIE(ret == -1, "msync");
+	os_shm_detach(heap);
+}
+
+void os_shm_set_root(os_shm_heap *heap, void *ptr)
+{
+	heap->root = os_shm_offset(heap, ptr);
+}
+
+void *os_shm_root(os_shm_heap *heap)
+{
+	return os_shm_ptr(heap, heap->root);
+}
+
+os_shm_heap *os_shm_attach(int fd)
+{
+	struct stat st;
+	int ret = fstat(fd, &st);
+	DIE(ret == -1, "fstat");
+	if ((size_t)st.st_size < sizeof(os_shm_heap))
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	os_shm_heap *heap = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	DIE(heap == MAP_FAILED, "mmap");
+	if (heap->magic != SHM_MAGIC || heap->size != (size_t)st.st_size)
+	{
+		ret = munmap(heap, st.st_size);
+		DIE(ret == -1, "munmap");
+		errno = EINVAL;
+		return NULL;
+	}
+	return heap;
+}
+
+void os_shm_detach(os_shm_heap *heap)
+{
+	if (!heap)
+	{
+		return;
+	}
+	int ret = munmap(heap, heap->size);
+	DIE(ret == -1, "munmap");
+}
+
+void *os_shm_malloc(os_shm_heap *heap, size_t size)
+{
+	if (!heap || size == 0)
+	{
+		return NULL;
+	}
+	size_t aligned_size = ALIGN(sizeof(shm_block)) + ALIGN(size);
+
+	if (shm_lock(heap) == -1)
+	{
+		return NULL;
+	}
+	shm_coalesce(heap);
+	shm_block *block = NULL;
+	for (shm_block *current = shm_at(heap, heap->first); current; current = shm_at(heap, current->next))
+	{
+		if (current->status == STATUS_FREE && current->size >= aligned_size &&
+			(!block || current->size < block->size))
+		{
+			block = current;
+		}
+	}
+	if (!block)
+	{
+		shm_unlock(heap);
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	//Split the block like the brk heap does, the new header is written before it is linked
+	if (block->size >= aligned_size + ALIGN(sizeof(shm_block) + ALIGN(1)))
+	{
+		shm_block *rest = (void *)block + aligned_size;
+		rest->size = block->size - aligned_size;
+		rest->status = STATUS_FREE;
+		rest->next = block->next;
+		block->next = shm_offset(heap, rest);
+		block->size = aligned_size;
+	}
+	block->status = STATUS_ALLOC;
+	shm_unlock(heap);
+	return (void *)block + ALIGN(sizeof(shm_block));
+}
+
+void os_shm_free(os_shm_heap *heap, void *ptr)
+{
+	if (!heap || !ptr)
+	{
+		return;
+	}
+
+	shm_block *block = ptr - ALIGN(sizeof(shm_block));
+	MISUSE((void *)block < (void *)heap || (void *)block >= (void *)heap + heap->size,
+		   "os_shm_free: not a block of this heap");
+	if (shm_lock(heap) == -1)
+	{
+		return;
+	}
+	MISUSE(block->status != STATUS_ALLOC, "os_shm_free: block is not allocated");
+	block->status = STATUS_FREE;
+	shm_unlock(heap);
+}
+
+size_t os_shm_offset(os_shm_heap *heap, void *ptr)
+{
+	return ptr ? (size_t)(ptr - (void *)heap) : 0;
+}
+
+void *os_shm_ptr(os_shm_heap *heap, size_t offset)
+{
+	return offset ? (void *)heap + offset : NULL;
+}
@@ -0,0 +1,274 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#define _GNU_SOURCE
+#include "osmem.h"
+#include "helpers.h"
+
+#ifdef OOB_METADATA
+
+#define TABLE_MIN_CAPACITY 1024
+
+/*Dense copy of the heap block list, kept in address order. Scans, splits
+and merges only touch these arrays, the inline header of a free block is
+written when the block is handed out again. zeroed carries the known-zero
+mark of free blocks, which lives in grows in the list*/
+static struct {
+	block_meta **block;
+	size_t *size;
+	unsigned char *status;
+	unsigned char *zeroed;
+	size_t count;
+	size_t capacity;
+} table;
+
+
+/**
+ * @brief Map an array for the table or move it to a bigger mapping
+ *
+ * @param array The array, NULL if it was never mapped
+ * @param old_size The current size of the array
+ * @param new_size The required size of the array
+ * @return void* The array
+ */
+static void *table_array(void *array, size_t old_size, size_t new_size)
+{
+	if (!array)
+	{
+		array = mmap(NULL, new_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		DIE(array == MAP_FAILED, "mmap");
+	}
+	else
+	{
+		array = mremap(array, old_size, new_size, MREMAP_MAYMOVE);
+		DIE(array == MAP_FAILED, "mremap");
+	}
+	return array;
+}
+
+static void table_reserve(size_t count)
+{
+	if (count <= table.capacity)
+	{
+		return;
+	}
+
+	size_t capacity = table.capacity ? 2 * table.capacity : TABLE_MIN_CAPACITY;
+	table.block = table_array(table.block, table.capacity * sizeof(*table.block),
+							  capacity * sizeof(*table.block));
+	table.size = table_array(table.size, table.capacity * sizeof(*table.size),
+							 capacity * sizeof(*table.size));
+	table.status = table_array(table.status, table.capacity * sizeof(*table.status),
+							   capacity * sizeof(*table.status));
+	table.zeroed = table_array(table.zeroed, table.capacity * sizeof(*table.zeroed),
+							   capacity * sizeof(*table.zeroed));
+	table.capacity = capacity;
+}
+
+/**
+ * @brief Find the entry of a heap block with a binary search on its address
+ *
+ * @param block The block
+ * @return size_t The index of the entry
+ */
+static size_t table_find(block_meta *block)
+{
+	size_t low = 0;
+	size_t high = table.count;
+	while (low < high)
+	{
+		size_t mid = low + (high - low) / 2;
+		if (table.block[mid] < block)
+		{
+			low = mid + 1;
+		}
+		else
+		{
+			high = mid;
+		}
+	}
+	MISUSE(low == table.count || table.block[low] != block, "meta lookup: not a heap block");
+	return low;
+}
+
+/* Move the entries from index on by count places, opening or closing a gap */
+static void table_shift(size_t index, long count)
+{
+	size_t moved = table.count - index;
+	memmove(table.block + index + count, table.block + index, moved * sizeof(*table.block));
+	memmove(table.size + index + count, table.size + index, moved * sizeof(*table.size));
+	memmove(table.status + index + count, table.status + index, moved * sizeof(*table.status));
+	memmove(table.zeroed + index + count, table.zeroed + index, moved * sizeof(*table.zeroed));
+	table.count += count;
+}
+
+/* Write an entry back into the inline header of its block */
+static block_meta *table_write(size_t index)
+{
+	block_meta *block = table.block[index];
+	block->size = table.size[index];
+	block->status = table.status[index];
+	if (block->status == STATUS_FREE)
+	{
+		block->grows = table.zeroed[index] ? BLOCK_ZEROED : 0;
+	}
+	block->next = NULL;
+	return block;
+}
+
+
+void meta_append(block_meta *block)
+{
+	table_reserve(table.count + 1);
+	table.block[table.count] = block;
+	table.size[table.count] = block->size;
+	table.status[table.count] = block->status;
+	table.zeroed[table.count] = block->status == STATUS_FREE && block->grows == BLOCK_ZEROED;
+	table.count++;
+}
+
+void meta_update(block_meta *block)
+{
+	size_t index = table_find(block);
+	table.size[index] = block->size;
+	table.status[index] = block->status;
+	table.zeroed[index] = block->status == STATUS_FREE && block->grows == BLOCK_ZEROED;
+}
+
+void meta_split(block_meta *block, size_t size)
+{
+	size_t index = table_find(block);
+	table_reserve(table.count + 1);
+	table_shift(index + 1, 1);
+	table.block[index + 1] = (void *)block + size;
+	table.size[index + 1] = table.size[index] - size;
+	table.status[index + 1] = STATUS_FREE;
+	table.zeroed[index + 1] = 0;
+	table.size[index] = size;
+	block->size = size;
+}
+
+block_meta *meta_best_fit(size_t size)
+{
+	size_t best = fit_scan(table.size, table.status, table.count, size);
+	return best == table.count ? NULL : table_write(best);
+}
+
+block_meta *meta_near_fit(void *hint, size_t size)
+{
+	/*The table is in address order, so start next to the hint and walk
+	outwards until the blocks are too far away. Ties go to the smaller
+	block, then to the lower address, like list_near_fit*/
+	size_t after = 0;
+	size_t high = table.count;
+	while (after < high)
+	{
+		size_t mid = after + (high - after) / 2;
+		if ((void *)table.block[mid] < hint)
+		{
+			after = mid + 1;
+		}
+		else
+		{
+			high = mid;
+		}
+	}
+
+	size_t best = table.count;
+	size_t best_distance = 0;
+	for (size_t i = after; i < table.count; i++)
+	{
+		size_t distance = block_distance(table.block[i], table.size[i], hint);
+		if (distance > MALLOC_NEAR_RANGE)
+		{
+			break;
+		}
+		if (table.status[i] == STATUS_FREE && table.size[i] >= size &&
+			(best == table.count || distance < best_distance ||
+			 (distance == best_distance && table.size[i] < table.size[best])))
+		{
+			best = i;
+			best_distance = distance;
+		}
+	}
+	for (size_t i = after; i-- > 0;)
+	{
+		size_t distance = block_distance(table.block[i], table.size[i], hint);
+		if (distance > MALLOC_NEAR_RANGE)
+		{
+			break;
+		}
+		if (table.status[i] == STATUS_FREE && table.size[i] >= size &&
+			(best == table.count || distance < best_distance ||
+			 (distance == best_distance && table.size[i] <= table.size[best])))
+		{
+			best = i;
+			best_distance = distance;
+		}
+	}
+	return best == table.count ? NULL : table_write(best);
+}
+
+block_meta *meta_coalesce(void)
+{
+	size_t last = 0;
+	for (size_t i = 1; i < table.count; i++)
+	{
+		if (table.status[i] == STATUS_FREE && table.status[last] == STATUS_FREE)
+		{
+			table.size[last] += table.size[i];
+			table.zeroed[last] = 0;
+			continue;
+		}
+		last++;
+		table.block[last] = table.block[i];
+		table.size[last] = table.size[i];
+		table.status[last] = table.status[i];
+		table.zeroed[last] = table.zeroed[i];
+	}
+	if (!table.count)
+	{
+		return NULL;
+	}
+	table.count = last + 1;
+	return table_write(last);
+}
+
+void meta_heap_stats(os_mem_stats *stats)
+{
+	for (size_t i = 0; i < table.count; i++)
+	{
+		if (table.status[i] == STATUS_FREE || table.status[i] == STATUS_ZEROING)
+		{
+			stats->heap_free_blocks++;
+			stats->heap_free_bytes += table.size[i];
+		}
+		else
+		{
+			stats->heap_blocks++;
+			stats->heap_bytes += table.size[i];
+		}
+	}
+}
+
+void meta_flush(void)
+{
+	for (size_t i = 0; i < table.count; i++)
+	{
+		table_write(i);
+	}
+}
+
+void meta_expand(block_meta *block)
+{
+	size_t index = table_find(block);
+	size_t next = index + 1;
+	while (next < table.count && table.status[next] == STATUS_FREE)
+	{
+		table.size[index] += table.size[next];
+		next++;
+	}
+	table_shift(next, -(long)(next - index - 1));
+	block->size = table.size[index];
+}
+
+#endif
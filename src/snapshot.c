@@ -0,0 +1,138 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "osmem.h"
+#include "helpers.h"
+
+#define SNAPSHOT_MAGIC 0x6f736d656d736e70UL
+
+extern block_meta *global_base;
+
+/*The first page of a snapshot holds this header, the heap follows from
+the page holding its first block up to the program break*/
+typedef struct snapshot_header {
+	unsigned long magic;
+	block_meta *base;
+	void *start;
+	size_t length;
+} snapshot_header;
+
+int os_heap_snapshot(const char *path)
+{
+	if (!path)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	size_t page_size = sysconf(_SC_PAGESIZE);
+	snapshot_header header = {SNAPSHOT_MAGIC, global_base, NULL, 0};
+	if (global_base)
+	{
+#ifdef OOB_METADATA
+		meta_flush();
+#endif
+		header.start = (void *)((uintptr_t)global_base & ~((uintptr_t)page_size - 1));
+		header.length = heap_sbrk(0) - header.start;
+	}
+
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+	if (fd == -1)
+	{
+		return -1;
+	}
+	int ret = ftruncate(fd, page_size + header.length);
+	DIE(ret == -1, "ftruncate");
+	ssize_t written = pwrite(fd, &header, sizeof(header), 0);
+	DIE(written != sizeof(header), "pwrite");
+	for (size_t done = 0; done < header.length;)
+	{
+		written = pwrite(fd, header.start + done, header.length - done, page_size + done);
+		DIE(written <= 0, "pwrite");
+		done += written;
+	}
+	ret = close(fd);
+	DIE(ret == -1, "close");
+	return 0;
+}
+
+int os_heap_restore(const char *path)
+{
+	if (!path)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+	//The restored heap replaces the whole brk heap, it has to be unused
+	if (global_base)
+	{
+		errno = EBUSY;
+		return -1;
+	}
+
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd == -1)
+	{
+		return -1;
+	}
+	//A truncated snapshot would map fine and fault on first touch
+	size_t page_size = sysconf(_SC_PAGESIZE);
+	snapshot_header header;
+	struct stat st;
+	int ret = fstat(fd, &st);
+	DIE(ret == -1, "fstat");
+	ssize_t got = pread(fd, &header, sizeof(header), 0);
+	if (got != sizeof(header) || header.magic != SNAPSHOT_MAGIC ||
+		(size_t)st.st_size != page_size + header.length)
+	{
+		close(fd);
+		errno = EINVAL;
+		return -1;
+	}
+	if (!header.base)
+	{
+		close(fd);
+		return 0;
+	}
+
+	/*Pointers into the heap are only valid at its old address, so the range
+	has to be free, then the heap itself is one private mapping of the file*/
+	size_t mapped = (header.length + page_size - 1) & ~(page_size - 1);
+	void *start = mmap(header.start, mapped + SNAPSHOT_RESERVE, PROT_NONE,
+					   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED_NOREPLACE, -1, 0);
+	if (start == MAP_FAILED)
+	{
+		close(fd);
+		return -1;
+	}
+	//Kernels before 4.17 take MAP_FIXED_NOREPLACE as a hint and map elsewhere
+	if (start != header.start)
+	{
+		ret = munmap(start, mapped + SNAPSHOT_RESERVE);
+		DIE(ret == -1, "munmap");
+		close(fd);
+		errno = EEXIST;
+		return -1;
+	}
+	if (mapped)
+	{
+		void *heap = mmap(start, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, page_size);
+		DIE(heap == MAP_FAILED, "mmap");
+	}
+	ret = close(fd);
+	DIE(ret == -1, "close");
+
+	//The heap grows into the rest of the reservation from now on
+	heap_adopt(start + header.length, start + mapped, start + mapped + SNAPSHOT_RESERVE);
+	global_base = header.base;
+
+#ifdef OOB_METADATA
+	//The side table is rebuilt from the headers, which the snapshot flushed
+	for (block_meta *block = global_base; (void *)block < start + header.length; block = (void *)block + block->size)
+	{
+		meta_append(block);
+	}
+#endif
+	return 0;
+}
@@ -0,0 +1,76 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "test-utils.h"
+
+int main(void)
+{
+	os_arena *arena, *other;
+	char *first, *ptr, *scratch, *moved, *copy, *blocker;
+	os_buf *buf;
+	os_scratch_pos mark;
+
+	moved = os_malloc_checked(100);
+	memset(moved, 4, 100);
+	blocker = os_malloc_checked(100);
+	arena = os_arena_create();
+	FAIL(arena == NULL, "DBG: os_arena_create returned NULL");
+
+	/* While pushed, os_malloc and os_calloc come from the arena */
+	FAIL(os_arena_push(arena) != 0, "DBG: os_arena_push failed");
+	first = os_malloc_checked(100);
+	memset(first, 1, 100);
+	ptr = os_calloc_checked(10, 10);
+	FAIL(ptr <= first || ptr - first > 256, "DBG: os_calloc did not use the arena");
+	os_free(first);
+	FAIL(first[0] != 1, "DBG: os_free touched an arena block");
+
+	/* Blocks bigger than a chunk work too */
+	ptr = os_malloc_checked(3 * MULT_KB * MULT_KB);
+	memset(ptr, 2, 3 * MULT_KB * MULT_KB);
+
+	/* Internal blocks do not come from the arena, they outlive it */
+	mark = os_scratch_mark();
+	scratch = os_scratch_alloc(100);
+	buf = os_buf_alloc(100);
+
+	/* and neither do blocks of the heap that move or get cloned */
+	moved = os_realloc(moved, 2000);
+	FAIL(moved == NULL, "DBG: os_realloc returned NULL on valid size");
+	copy = os_clone(moved);
+	FAIL(copy == NULL, "DBG: os_clone returned NULL");
+	FAIL(os_arena_pop() != arena, "DBG: os_arena_pop returned another arena");
+
+	/* Reset drops every block, the first one comes back */
+	os_arena_reset(arena);
+	FAIL(os_arena_malloc(arena, 100) != first, "DBG: os_arena_reset did not rewind the arena");
+	memset(os_arena_malloc(arena, 8000), 5, 8000);
+	for (int i = 0; i < 100; i++)
+		FAIL(moved[i] != 4 || copy[i] != 4, "DBG: block moved into the arena was dropped with it");
+	os_free(copy);
+	os_free(moved);
+	os_free(blocker);
+
+	/* Arenas nest, and popping goes back to the heap */
+	other = os_arena_create();
+	os_arena_push(arena);
+	os_arena_push(other);
+	ptr = os_malloc_checked(50);
+	FAIL(os_arena_pop() != other || os_arena_pop() != arena, "DBG: arenas did not pop in order");
+	FAIL(os_arena_pop() != NULL, "DBG: os_arena_pop of an empty stack returned an arena");
+	os_arena_destroy(other);
+	FAIL(page_mapped(ptr), "DBG: os_arena_destroy left the arena mapped");
+	os_arena_destroy(arena);
+
+	memset(scratch, 3, 100);
+	memset(buf->data, 3, 100);
+	scratch = os_scratch_alloc(100);
+	FAIL(scratch == NULL, "DBG: scratch stack broken by os_arena_destroy");
+	os_scratch_release(mark);
+	os_buf_release(buf);
+
+	ptr = os_malloc_checked(100);
+	os_free(ptr);
+	FAIL(os_arena_push(NULL) != -1 || errno != EINVAL, "DBG: os_arena_push accepted NULL");
+
+	return 0;
+}
@@ -0,0 +1,42 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "test-utils.h"
+
+int main(void)
+{
+	os_buf *buf, *slice, *inner;
+	os_mem_stats before, after;
+
+	os_free(os_malloc_checked(1));
+	os_stats(&before);
+
+	buf = os_buf_alloc(1000);
+	FAIL(buf == NULL || buf->data == NULL || buf->len != 1000, "DBG: os_buf_alloc failed");
+	memset(buf->data, 1, 1000);
+
+	/* Slices share the payload without copying */
+	slice = os_buf_slice(buf, 100, 500);
+	FAIL(slice == NULL || slice->data != (char *)buf->data + 100 || slice->len != 500,
+		 "DBG: slice does not point into its buffer");
+	inner = os_buf_slice(slice, 400, 100);
+	FAIL(inner == NULL || inner->data != (char *)buf->data + 500, "DBG: slice of a slice is misplaced");
+
+	/* Ranges past the end are refused */
+	errno = 0;
+	FAIL(os_buf_slice(buf, 900, 101) != NULL || errno != EINVAL, "DBG: slice past the end accepted");
+	FAIL(os_buf_slice(slice, 501, 0) != NULL, "DBG: slice past the end accepted");
+
+	/* The payload lives as long as any handle */
+	os_buf_release(buf);
+	os_buf_release(slice);
+	memset(inner->data, 2, inner->len);
+	os_stats(&after);
+	FAIL(after.heap_blocks == before.heap_blocks, "DBG: payload freed before its last slice");
+	FAIL(((char *)inner->data)[0] != 2, "DBG: slice lost its payload");
+	os_buf_release(inner);
+
+	os_stats(&after);
+	FAIL(after.heap_blocks != before.heap_blocks, "DBG: payload not freed with its last slice");
+
+	return 0;
+}
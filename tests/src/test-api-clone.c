@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "test-utils.h"
+
+#define BLOCK_SIZE	(MULT_KB * MULT_KB)
+
+static int filled(char *ptr, size_t size, char value)
+{
+	for (size_t i = 0; i < size; i += 512)
+		if (ptr[i] != value)
+			return 0;
+	return ptr[size - 1] == value;
+}
+
+int main(void)
+{
+	char *block, *first, *second, *small, *copy;
+
+	block = os_malloc_checked(BLOCK_SIZE);
+	memset(block, 1, BLOCK_SIZE);
+
+	/* A clone starts with the same contents */
+	first = os_clone(block);
+	FAIL(first == NULL || first == block, "DBG: os_clone failed");
+	FAIL(!filled(first, BLOCK_SIZE, 1), "DBG: clone does not match its source");
+
+	/* Writes on either side stay private */
+	memset(block, 2, BLOCK_SIZE / 2);
+	FAIL(!filled(first, BLOCK_SIZE, 1), "DBG: write to the source leaked into the clone");
+	memset(first + BLOCK_SIZE / 2, 3, BLOCK_SIZE / 2);
+	FAIL(!filled(block + BLOCK_SIZE / 2, BLOCK_SIZE / 2, 1), "DBG: write to the clone leaked into the source");
+
+	/* A later clone sees the pages the source changed since */
+	second = os_clone(block);
+	FAIL(!filled(second, BLOCK_SIZE / 2, 2) || !filled(second + BLOCK_SIZE / 2, BLOCK_SIZE / 2, 1),
+		 "DBG: clone missed changes of its source");
+
+	/* Clones of clones, and clones outliving their source */
+	copy = os_clone(first);
+	FAIL(!filled(copy, BLOCK_SIZE / 2, 1) || !filled(copy + BLOCK_SIZE / 2, BLOCK_SIZE / 2, 3),
+		 "DBG: clone of a clone does not match");
+	os_free(block);
+	os_free(first);
+	FAIL(!filled(second, BLOCK_SIZE / 2, 2), "DBG: freeing the source broke a clone");
+
+	/* os_realloc moves a clone to a regular block */
+	second = os_realloc(second, 2 * BLOCK_SIZE);
+	FAIL(second == NULL || !filled(second, BLOCK_SIZE / 2, 2), "DBG: os_realloc of a clone lost the data");
+	os_free(second);
+	os_free(copy);
+
+	/* Heap blocks are copied */
+	small = os_malloc_checked(100);
+	memset(small, 4, 100);
+	copy = os_clone(small);
+	FAIL(copy == NULL || copy == small || !filled(copy, 100, 4), "DBG: clone of a heap block failed");
+	os_free(copy);
+	os_free(small);
+	FAIL(os_clone(NULL) != NULL, "DBG: clone of NULL returned a block");
+
+	return 0;
+}
@@ -0,0 +1,55 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "test-utils.h"
+
+#define NUM_PIECES	8
+
+int main(void)
+{
+	size_t sizes[NUM_PIECES] = {24, 100, 8, 4000, 333, 16, 1024, 72};
+	void *ptrs[NUM_PIECES], **group;
+	os_mem_stats before, after;
+
+	os_free(os_malloc_checked(1));
+	os_stats(&before);
+
+	/* Pieces are laid out next to each other, in order */
+	FAIL(os_independent_comalloc(NUM_PIECES, sizes, ptrs) != ptrs, "DBG: os_independent_comalloc failed");
+	for (int i = 0; i < NUM_PIECES; i++) {
+		FAIL(os_malloc_usable_size(ptrs[i]) < sizes[i], "DBG: piece smaller than requested");
+		memset(ptrs[i], i + 1, sizes[i]);
+		if (i)
+			FAIL(ptrs[i] <= ptrs[i - 1] || ptrs[i] - ptrs[i - 1] > 2 * (long)sizes[i - 1] + 64,
+				 "DBG: pieces are not next to each other");
+	}
+
+	/* Each piece is freed on its own, in any order */
+	for (int i = 1; i < NUM_PIECES; i += 2)
+		os_free(ptrs[i]);
+	for (int i = 0; i < NUM_PIECES; i += 2) {
+		for (size_t j = 0; j < sizes[i]; j++)
+			FAIL(((char *)ptrs[i])[j] != i + 1, "DBG: freeing a piece corrupted its neighbours");
+		os_free(ptrs[i]);
+	}
+	os_stats(&after);
+	FAIL(after.heap_blocks != before.heap_blocks, "DBG: pieces still in use after os_free");
+
+	/* Zeroed pieces, with the array allocated in front of them */
+	group = os_independent_calloc(NUM_PIECES, 500, NULL);
+	FAIL(group == NULL, "DBG: os_independent_calloc returned NULL");
+	for (int i = 0; i < NUM_PIECES; i++) {
+		for (int j = 0; j < 500; j++)
+			FAIL(((char *)group[i])[j] != 0, "DBG: os_independent_calloc returned uninitialized memory");
+		os_free(group[i]);
+	}
+	os_free(group);
+
+	/* Groups over the threshold are separate blocks */
+	sizes[0] = MMAP_THRESHOLD;
+	FAIL(os_independent_comalloc(2, sizes, ptrs) != ptrs, "DBG: os_independent_comalloc failed");
+	memset(ptrs[0], 1, MMAP_THRESHOLD);
+	os_free(ptrs[0]);
+	os_free(ptrs[1]);
+
+	return 0;
+}
@@ -0,0 +1,87 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include "test-utils.h"
+
+#define NUM_RETIRED	256
+
+static atomic_int reader_in;
+static atomic_int reader_go;
+static atomic_int writer_go;
+static char *volatile shared;
+
+static void *reader(void *arg)
+{
+	char *seen;
+
+	(void)arg;
+	os_epoch_enter();
+	seen = shared;
+	atomic_store(&reader_in, 1);
+	while (!atomic_load(&reader_go))
+		;
+	/* The block was retired meanwhile, but stays readable until we leave */
+	FAIL(seen[0] != 1, "DBG: block freed under a reader");
+	os_epoch_exit();
+	return NULL;
+}
+
+/* Retires a block and exits, leaving it to the other threads */
+static void *writer(void *arg)
+{
+	while (!atomic_load(&writer_go))
+		;
+	os_free_deferred(arg);
+	return NULL;
+}
+
+static void retire_many(void)
+{
+	for (int i = 0; i < NUM_RETIRED; i++)
+		os_free_deferred(os_malloc_checked(16));
+}
+
+int main(void)
+{
+	pthread_t thread, other;
+	char *block, *orphan;
+
+	/* Threads start before the brk heap is used, since glibc moves brk for them */
+	block = os_malloc_checked(2 * MMAP_THRESHOLD);
+	memset(block, 1, 2 * MMAP_THRESHOLD);
+	shared = block;
+	orphan = os_malloc_checked(2 * MMAP_THRESHOLD);
+	FAIL(pthread_create(&thread, NULL, reader, NULL) != 0, "DBG: pthread_create failed");
+	FAIL(pthread_create(&other, NULL, writer, orphan) != 0, "DBG: pthread_create failed");
+	while (!atomic_load(&reader_in))
+		;
+
+	/* Unlink and retire the block while the reader is inside */
+	shared = NULL;
+	os_free_deferred(block);
+	retire_many();
+	FAIL(!page_mapped(block), "DBG: retired block freed while a reader was in its epoch");
+
+	/* Once the reader is out, the epoch moves on and the block goes */
+	atomic_store(&reader_go, 1);
+	pthread_join(thread, NULL);
+	retire_many();
+	FAIL(page_mapped(block), "DBG: retired block never freed");
+
+	/* A thread exits without freeing, a later reclaim frees what it retired */
+	atomic_store(&writer_go, 1);
+	pthread_join(other, NULL);
+	FAIL(!page_mapped(orphan), "DBG: exiting thread freed its retired block");
+	retire_many();
+	FAIL(page_mapped(orphan), "DBG: block retired by an exited thread never freed");
+
+	/* Nested sections and NULL are fine */
+	os_epoch_enter();
+	os_epoch_enter();
+	os_free_deferred(NULL);
+	os_epoch_exit();
+	os_epoch_exit();
+
+	return 0;
+}
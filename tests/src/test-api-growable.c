@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "test-utils.h"
+
+#define MAX_SIZE	(64 * MULT_KB * MULT_KB)
+#define OVER_SIZE	(MAX_SIZE + 2 * getpagesize())
+
+int main(void)
+{
+	char *buf, *moved;
+
+	buf = os_growable_create(MAX_SIZE);
+	FAIL(buf == NULL, "DBG: os_growable_create returned NULL");
+
+	/* Growing commits pages in place */
+	FAIL(os_growable_resize(buf, 4 * MULT_KB) != 0, "DBG: os_growable_resize failed");
+	memset(buf, 1, 4 * MULT_KB);
+	FAIL(os_growable_resize(buf, 8 * MULT_KB * MULT_KB) != 0, "DBG: os_growable_resize failed");
+	memset(buf + 4 * MULT_KB, 2, 8 * MULT_KB * MULT_KB - 4 * MULT_KB);
+	FAIL(buf[0] != 1 || buf[4 * MULT_KB - 1] != 1, "DBG: growing lost the data");
+
+	/* Shrinking keeps the start of the buffer */
+	FAIL(os_growable_resize(buf, MULT_KB) != 0, "DBG: os_growable_resize failed to shrink");
+	FAIL(buf[0] != 1, "DBG: shrinking lost the data");
+
+	/* The reservation is a hard limit */
+	errno = 0;
+	FAIL(os_growable_resize(buf, OVER_SIZE) != -1 || errno != ENOMEM,
+		 "DBG: os_growable_resize went past the reservation");
+
+	/* os_realloc stays in place inside the reservation */
+	FAIL(os_realloc(buf, 2 * MULT_KB * MULT_KB) != buf, "DBG: os_realloc moved a growable buffer");
+	FAIL(buf[0] != 1, "DBG: os_realloc lost the data");
+
+	/* and moves the data past it */
+	moved = os_realloc(buf, OVER_SIZE);
+	FAIL(moved == NULL || moved == buf, "DBG: os_realloc did not move past the reservation");
+	FAIL(moved[0] != 1, "DBG: os_realloc lost the data");
+	FAIL(page_mapped(buf), "DBG: old reservation still mapped");
+	os_free(moved);
+
+	/* os_free unmaps the whole reservation */
+	buf = os_growable_create(MAX_SIZE);
+	FAIL(os_growable_resize(buf, 3 * MULT_KB * MULT_KB) != 0, "DBG: os_growable_resize failed");
+	os_free(buf);
+	FAIL(page_mapped(buf) || page_mapped(buf + 2 * MULT_KB * MULT_KB), "DBG: reservation still mapped");
+
+	return 0;
+}
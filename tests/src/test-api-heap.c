@@ -0,0 +1,43 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "test-utils.h"
+
+#define BIG_SIZE	(1536 * MULT_KB + 100)
+#define MID_SIZE	(1000 * MULT_KB)
+
+int main(void)
+{
+	os_heap *heap;
+	char *big, *mid, *small;
+
+	heap = os_heap_create();
+	FAIL(heap == NULL, "DBG: os_heap_create returned NULL");
+
+	/* A block bigger than a region gets a region of its own */
+	big = os_heap_malloc(heap, BIG_SIZE);
+	mid = os_heap_malloc(heap, MID_SIZE);
+	small = os_heap_malloc(heap, 16);
+	FAIL(big == NULL || mid == NULL || small == NULL, "DBG: os_heap_malloc returned NULL on valid size");
+	FAIL(small >= big && small < big + BIG_SIZE + getpagesize(),
+		 "DBG: block placed in the tail of a big block's region");
+	memset(big, 1, BIG_SIZE);
+	memset(mid, 2, MID_SIZE);
+
+	/* Small blocks grow and go back to their own heap */
+	small = os_realloc(small, 4096);
+	FAIL(small == NULL, "DBG: os_realloc of a heap block returned NULL");
+	memset(small, 3, 4096);
+	os_heap_free(heap, small);
+
+	/* The region of a big block is unmapped with it */
+	os_heap_free(heap, big);
+	FAIL(page_mapped(big), "DBG: region of a freed big block is still mapped");
+	for (int i = 0; i < MID_SIZE; i++)
+		FAIL(mid[i] != 2, "DBG: heap block corrupted");
+
+	/* Destroying the heap drops every block at once */
+	os_heap_destroy(heap);
+	FAIL(page_mapped(mid), "DBG: heap still mapped after os_heap_destroy");
+
+	return 0;
+}
@@ -0,0 +1,48 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "test-utils.h"
+
+#define NUM_BUFS	16
+
+int main(void)
+{
+	long page = getpagesize();
+	char *bufs[NUM_BUFS], *buf, *big;
+
+	/* Buffers are page aligned and fully usable */
+	for (int i = 0; i < NUM_BUFS; i++) {
+		bufs[i] = os_iobuf_alloc(1 + i * 1000);
+		FAIL(bufs[i] == NULL, "DBG: os_iobuf_alloc returned NULL on valid size");
+		FAIL((long)bufs[i] % page, "DBG: I/O buffer not page aligned");
+		memset(bufs[i], i, 1 + i * 1000);
+	}
+	for (int i = 0; i < NUM_BUFS; i++)
+		FAIL(bufs[i][i * 1000] != i, "DBG: I/O buffers overlap");
+
+	/* A freed buffer is handed out again for its size class */
+	buf = bufs[3];
+	os_iobuf_free(buf);
+	FAIL(os_iobuf_alloc(page) != buf, "DBG: freed I/O buffer not recycled");
+	os_iobuf_free(buf);
+	FAIL(os_iobuf_alloc(page / 2) != buf, "DBG: freed I/O buffer not recycled for a smaller size");
+
+	/* Sizes past the biggest class get a chunk of their own */
+	big = os_iobuf_alloc(4 * MULT_KB * MULT_KB);
+	FAIL(big == NULL || (long)big % page, "DBG: big I/O buffer failed");
+	memset(big, 1, 4 * MULT_KB * MULT_KB);
+	os_iobuf_free(big);
+	FAIL(page_mapped(big), "DBG: big I/O buffer still mapped after free");
+
+	/* Locking is best effort */
+	os_iobuf_mlock(1);
+	buf = os_iobuf_alloc(64 * page);
+	FAIL(buf == NULL, "DBG: os_iobuf_alloc failed with mlock on");
+	os_iobuf_free(buf);
+	os_iobuf_mlock(0);
+
+	FAIL(os_iobuf_alloc(0) != NULL, "DBG: os_iobuf_alloc of 0 bytes returned a buffer");
+	for (int i = 0; i < NUM_BUFS; i++)
+		os_iobuf_free(bufs[i]);
+
+	return 0;
+}
@@ -0,0 +1,40 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "test-utils.h"
+
+#define NUM_BLOCKS	32
+
+int main(void)
+{
+	unsigned int flags[] = {OSMEM_SHORT_LIVED, OSMEM_LONG_LIVED, OSMEM_COLD, OSMEM_COLD | OSMEM_LONG_LIVED};
+	char *ptrs[4][NUM_BLOCKS];
+
+	for (int f = 0; f < 4; f++)
+		for (int i = 0; i < NUM_BLOCKS; i++) {
+			ptrs[f][i] = os_malloc_flags(100 + i, flags[f]);
+			FAIL(ptrs[f][i] == NULL, "DBG: os_malloc_flags returned NULL on valid size");
+			memset(ptrs[f][i], f + 1, 100 + i);
+		}
+
+	/* Each class is packed in its own heap, cold wins over long-lived */
+	FAIL((unsigned long)(ptrs[0][1] - ptrs[0][0]) > 1024, "DBG: short-lived blocks are not packed together");
+	FAIL((unsigned long)(ptrs[1][1] - ptrs[1][0]) > 1024, "DBG: long-lived blocks are not packed together");
+	FAIL((unsigned long)(ptrs[3][0] - ptrs[2][NUM_BLOCKS - 1]) > 1024, "DBG: cold flag did not take precedence");
+	FAIL((unsigned long)ptrs[0][0] / MULT_KB / MULT_KB == (unsigned long)ptrs[1][0] / MULT_KB / MULT_KB,
+		 "DBG: short and long-lived blocks share a region");
+
+	/* No flag is a plain os_malloc */
+	FAIL(os_malloc_flags(0, OSMEM_SHORT_LIVED) != NULL, "DBG: os_malloc_flags of 0 bytes returned a block");
+	os_free(os_malloc_flags(10, 0));
+
+	/* Blocks grow and go away with os_free */
+	ptrs[0][0] = os_realloc(ptrs[0][0], 10000);
+	FAIL(ptrs[0][0] == NULL || ptrs[0][0][99] != 1, "DBG: os_realloc corrupted a lifetime block");
+	for (int f = 0; f < 4; f++)
+		for (int i = 0; i < NUM_BLOCKS; i++) {
+			FAIL(ptrs[f][i][0] != f + 1, "DBG: lifetime block corrupted");
+			os_free(ptrs[f][i]);
+		}
+
+	return 0;
+}
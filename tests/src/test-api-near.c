@@ -0,0 +1,51 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "test-utils.h"
+
+#define NEAR_RANGE	(64 * MULT_KB)
+#define NUM_BLOCKS	64
+
+static size_t distance(void *a, void *b)
+{
+	return a > b ? (size_t)(a - b) : (size_t)(b - a);
+}
+
+int main(void)
+{
+	void *ptrs[NUM_BLOCKS], *hint, *near, *far;
+	os_heap *heap;
+
+	/* Free every other block so there are holes all over the heap */
+	for (int i = 0; i < NUM_BLOCKS; i++)
+		ptrs[i] = os_malloc_checked(1000);
+	for (int i = 0; i < NUM_BLOCKS; i += 2)
+		os_free(ptrs[i]);
+
+	/* The block lands in the hole next to its hint */
+	hint = ptrs[NUM_BLOCKS / 2 + 1];
+	near = os_malloc_near(hint, 200);
+	FAIL(near == NULL, "DBG: os_malloc_near returned NULL on valid size");
+	FAIL(distance(near, hint) > 2 * 1024, "DBG: os_malloc_near placed the block far from its hint");
+	memset(near, 1, 200);
+
+	/* No hint, or no hole in range, falls back to os_malloc */
+	far = os_malloc_near(NULL, 300);
+	FAIL(far == NULL, "DBG: os_malloc_near without hint returned NULL");
+	os_free(far);
+	far = os_malloc_near(hint, 2 * NEAR_RANGE);
+	FAIL(far == NULL, "DBG: os_malloc_near without a close hole returned NULL");
+	os_free(far);
+
+	/* A hint from an os_heap stays in that heap */
+	heap = os_heap_create();
+	hint = os_heap_malloc(heap, 100);
+	near = os_malloc_near(hint, 100);
+	FAIL(distance(near, hint) > NEAR_RANGE, "DBG: os_malloc_near left the heap of its hint");
+	os_free(near);
+	os_heap_destroy(heap);
+
+	for (int i = 1; i < NUM_BLOCKS; i += 2)
+		os_free(ptrs[i]);
+
+	return 0;
+}
@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "test-utils.h"
+
+int main(void)
+{
+	int nodes = os_numa_nodes(), node = os_numa_node();
+	os_mem_stats stats;
+	char *ptr, *local;
+
+	/* Machines without NUMA still have node 0 */
+	FAIL(nodes < 1, "DBG: os_numa_nodes returned no node");
+	FAIL(node < 0 || node >= nodes, "DBG: os_numa_node out of range");
+
+	ptr = os_malloc_onnode(1000, 0);
+	FAIL(ptr == NULL, "DBG: os_malloc_onnode returned NULL on node 0");
+	memset(ptr, 1, 1000);
+	local = os_malloc_local(2000);
+	FAIL(local == NULL, "DBG: os_malloc_local returned NULL");
+	memset(local, 2, 2000);
+
+	/* Unknown nodes are refused */
+	errno = 0;
+	FAIL(os_malloc_onnode(100, nodes) != NULL || errno != EINVAL, "DBG: os_malloc_onnode accepted a missing node");
+	FAIL(os_malloc_onnode(100, -1) != NULL, "DBG: os_malloc_onnode accepted a negative node");
+	FAIL(os_numa_stats(nodes, &stats) != -1, "DBG: os_numa_stats accepted a missing node");
+
+	/* Per-node stats count the blocks of that node */
+	FAIL(os_numa_stats(0, &stats) != 0, "DBG: os_numa_stats failed on node 0");
+	if (node == 0)
+		FAIL(stats.heap_blocks != 2, "DBG: os_numa_stats missed a block");
+	else
+		FAIL(stats.heap_blocks != 1, "DBG: os_numa_stats missed a block");
+	FAIL(stats.heap_bytes < 1000, "DBG: os_numa_stats counted too few bytes");
+
+	/* Node blocks grow and go away with os_free */
+	ptr = os_realloc(ptr, 5000);
+	FAIL(ptr == NULL || ptr[999] != 1, "DBG: os_realloc of a node block lost the data");
+	os_free(ptr);
+	os_free(local);
+	os_numa_stats(0, &stats);
+	FAIL(stats.heap_blocks != 0, "DBG: freed node blocks still counted");
+
+	return 0;
+}
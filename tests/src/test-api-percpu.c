@@ -0,0 +1,38 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "test-utils.h"
+
+#define CACHE_LINE	64
+
+int main(void)
+{
+	long *counter, *copy, sum = 0;
+	int cpus = os_percpu_cpus();
+
+	FAIL(cpus < 1, "DBG: os_percpu_cpus returned no CPU");
+	counter = os_malloc_percpu(sizeof(long));
+	FAIL(counter == NULL, "DBG: os_malloc_percpu returned NULL on valid size");
+
+	/* Copies are zeroed and each starts on its own cache line */
+	for (int cpu = 0; cpu < cpus; cpu++) {
+		copy = os_percpu_ptr(counter, cpu);
+		FAIL(copy == NULL || *copy != 0, "DBG: per-CPU copy is not zeroed");
+		FAIL((unsigned long)copy % CACHE_LINE, "DBG: per-CPU copy not aligned to a cache line");
+		if (cpu)
+			FAIL((char *)copy - (char *)os_percpu_ptr(counter, cpu - 1) < CACHE_LINE,
+				 "DBG: per-CPU copies share a cache line");
+		*copy = cpu + 1;
+	}
+	FAIL(os_percpu_ptr(counter, cpus) != NULL || os_percpu_ptr(counter, -1) != NULL,
+		 "DBG: os_percpu_ptr accepted a CPU out of range");
+
+	/* The local copy is one of them */
+	*(long *)os_percpu_this(counter) += 100;
+	os_percpu_for_each(cpu, copy, counter)
+		sum += *copy;
+	FAIL(sum != (long)cpus * (cpus + 1) / 2 + 100, "DBG: os_percpu_for_each missed a copy");
+
+	os_free_percpu(counter);
+
+	return 0;
+}
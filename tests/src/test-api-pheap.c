@@ -0,0 +1,76 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <sys/wait.h>
+#include "test-utils.h"
+
+#define HEAP_SIZE	(64 * MULT_KB)
+#define NUM_ROUNDS	2000
+
+int main(void)
+{
+	char path[] = "/tmp/osmem-pheap-XXXXXX";
+	os_shm_heap *heap, *other;
+	char *text, byte = 0x7f;
+	size_t offset;
+	int fd, status;
+	pid_t pid;
+
+	fd = mkstemp(path);
+	FAIL(fd < 0, "DBG: mkstemp failed");
+	close(fd);
+
+	/* An empty file gets a new heap */
+	heap = os_pheap_open(path, HEAP_SIZE, NULL);
+	FAIL(heap == NULL, "DBG: os_pheap_open returned NULL");
+	text = os_shm_malloc(heap, 64);
+	FAIL(text == NULL, "DBG: os_shm_malloc returned NULL on valid size");
+	strcpy(text, "persistent");
+	os_shm_set_root(heap, text);
+	offset = os_shm_offset(heap, text);
+	os_shm_free(heap, os_shm_malloc(heap, 100));
+	os_pheap_close(heap);
+
+	/* Reopening maps the blocks back, the size comes from the file */
+	heap = os_pheap_open(path, 0, NULL);
+	FAIL(heap == NULL, "DBG: os_pheap_open failed to reopen the heap");
+	text = os_shm_root(heap);
+	FAIL(text == NULL || strcmp(text, "persistent") != 0, "DBG: root lost across reopen");
+	FAIL(os_shm_malloc(heap, 100) == NULL, "DBG: reopened heap cannot allocate");
+
+	/* Opening a heap another process uses leaves its lock alone */
+	pid = fork();
+	FAIL(pid < 0, "DBG: fork failed");
+	if (pid == 0) {
+		for (int i = 0; i < NUM_ROUNDS; i++) {
+			other = os_pheap_open(path, 0, NULL);
+			FAIL(other == NULL, "DBG: os_pheap_open failed on a heap in use");
+			os_pheap_close(other);
+		}
+		exit(0);
+	}
+	for (int i = 0; waitpid(pid, &status, WNOHANG) == 0; i++)
+		os_shm_free(heap, os_shm_malloc(heap, 100 + i % 64));
+	FAIL(!WIFEXITED(status) || WEXITSTATUS(status) != 0, "DBG: child failed");
+	os_pheap_close(heap);
+	heap = os_pheap_open(path, 0, NULL);
+	FAIL(heap == NULL, "DBG: heap corrupted by a concurrent open");
+	os_pheap_close(heap);
+
+	/* A corrupt block list is refused, here the top byte of a block size */
+	fd = open(path, O_RDWR);
+	FAIL(pwrite(fd, &byte, 1, offset - METADATA_SIZE + sizeof(size_t) - 1) != 1, "DBG: pwrite failed");
+	close(fd);
+	errno = 0;
+	FAIL(os_pheap_open(path, 0, NULL) != NULL || errno != EINVAL, "DBG: os_pheap_open accepted a corrupt heap");
+
+	/* and so is a file that is not a heap */
+	fd = open(path, O_RDWR | O_TRUNC);
+	FAIL(write(fd, path, sizeof(path)) != sizeof(path), "DBG: write failed");
+	close(fd);
+	errno = 0;
+	FAIL(os_pheap_open(path, 0, NULL) != NULL || errno != EINVAL, "DBG: os_pheap_open accepted a foreign file");
+
+	unlink(path);
+
+	return 0;
+}
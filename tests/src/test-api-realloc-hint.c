@@ -0,0 +1,37 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "test-utils.h"
+
+#define EXPECTED_MAX	(64 * MULT_KB)
+
+int main(void)
+{
+	char *ptr, *grown;
+
+	/* Usable size covers at least the request */
+	ptr = os_malloc_checked(100);
+	FAIL(os_malloc_usable_size(ptr) < 100, "DBG: os_malloc_usable_size below the request");
+	FAIL(os_malloc_usable_size(NULL) != 0, "DBG: os_malloc_usable_size of NULL is not 0");
+	memset(ptr, 1, 100);
+
+	/* A hint provisions the expected size once */
+	ptr = os_realloc_hint(ptr, 200, EXPECTED_MAX);
+	FAIL(ptr == NULL, "DBG: os_realloc_hint returned NULL on valid size");
+	FAIL(os_malloc_usable_size(ptr) < EXPECTED_MAX, "DBG: os_realloc_hint did not provision the hint");
+	FAIL(ptr[0] != 1 || ptr[99] != 1, "DBG: os_realloc_hint corrupted memory");
+
+	/* and later reallocs up to it stay in place */
+	for (size_t size = 256; size <= EXPECTED_MAX; size *= 2) {
+		grown = os_realloc(ptr, size);
+		FAIL(grown != ptr, "DBG: os_realloc moved a block within its hint");
+		memset(grown + size / 2, 2, size / 2);
+	}
+	FAIL(ptr[0] != 1, "DBG: os_realloc corrupted memory");
+
+	/* Growing past the hint still works */
+	grown = os_realloc(ptr, 2 * EXPECTED_MAX);
+	FAIL(grown == NULL || grown[0] != 1, "DBG: os_realloc past the hint corrupted memory");
+	os_free(grown);
+
+	return 0;
+}
@@ -0,0 +1,42 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "test-utils.h"
+
+int main(void)
+{
+	char *ring, *moved, text[] = "wraps around the end";
+	size_t size;
+	os_mem_stats stats;
+
+	ring = os_malloc_ring(5000);
+	FAIL(ring == NULL, "DBG: os_malloc_ring returned NULL on valid size");
+	size = os_ring_size(ring);
+	FAIL(size < 5000 || size % getpagesize(), "DBG: ring size not rounded to pages");
+
+	/* The second view aliases the first, so a write past the end wraps */
+	memcpy(ring + size - 5, text, sizeof(text));
+	FAIL(memcmp(ring, text + 5, sizeof(text) - 5) != 0, "DBG: write past the end did not wrap");
+	ring[0] = 'W';
+	FAIL(ring[size] != 'W', "DBG: views are not the same memory");
+
+	/* Accesses of the whole ring size work from any offset */
+	memset(ring + size / 2, 7, size);
+	for (size_t i = 0; i < size; i++)
+		FAIL(ring[i] != 7, "DBG: ring access of its whole size failed");
+
+	os_stats(&stats);
+	FAIL(stats.ring_blocks != 1 || stats.ring_bytes != size, "DBG: os_stats missed the ring");
+
+	/* os_realloc moves the data to a bigger ring */
+	moved = os_realloc(ring, 3 * size);
+	FAIL(moved == NULL || os_ring_size(moved) < 3 * size, "DBG: os_realloc of a ring failed");
+	FAIL(moved[0] != 7 || moved[size - 1] != 7, "DBG: os_realloc of a ring lost the data");
+	moved[os_ring_size(moved)] = 1;
+	FAIL(moved[0] != 1, "DBG: moved ring does not wrap");
+
+	os_free(moved);
+	os_stats(&stats);
+	FAIL(stats.ring_blocks != 0 || stats.ring_bytes != 0, "DBG: freed ring still counted");
+
+	return 0;
+}
@@ -0,0 +1,44 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "test-utils.h"
+
+#define CHUNK_SIZE	(64 * MULT_KB)
+
+int main(void)
+{
+	os_scratch_pos outer, inner, mark;
+	char *first, *second, *big;
+
+	/* Releasing to a mark hands the same memory out again */
+	outer = os_scratch_mark();
+	first = os_scratch_alloc(100);
+	FAIL(first == NULL, "DBG: os_scratch_alloc returned NULL on valid size");
+	memset(first, 1, 100);
+	inner = os_scratch_mark();
+	second = os_scratch_alloc(200);
+	FAIL(second < first + 100, "DBG: scratch allocations overlap");
+	os_scratch_release(inner);
+	FAIL(os_scratch_alloc(200) != second, "DBG: released scratch memory not reused");
+	FAIL(first[99] != 1, "DBG: release dropped memory from before the mark");
+
+	/* Overflowing a chunk chains a new one, and releasing drops it */
+	inner = os_scratch_mark();
+	for (int i = 0; i < 10; i++) {
+		big = os_scratch_alloc(CHUNK_SIZE / 4);
+		FAIL(big == NULL, "DBG: os_scratch_alloc failed to grow");
+		memset(big, i, CHUNK_SIZE / 4);
+	}
+	big = os_scratch_alloc(4 * CHUNK_SIZE);
+	FAIL(big == NULL, "DBG: scratch allocation bigger than a chunk failed");
+	memset(big, 1, 4 * CHUNK_SIZE);
+	os_scratch_release(inner);
+	FAIL(first[0] != 1, "DBG: release dropped an older chunk");
+
+	os_scratch_release(outer);
+	FAIL(os_scratch_alloc(0) != NULL, "DBG: os_scratch_alloc of 0 bytes returned memory");
+	mark = os_scratch_mark();
+	FAIL(os_scratch_alloc(100) == NULL, "DBG: os_scratch_alloc failed after releasing everything");
+	os_scratch_release(mark);
+
+	return 0;
+}
@@ -0,0 +1,46 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <sys/wait.h>
+#include "test-utils.h"
+
+#define BLOCK_SIZE	(3 * 4096)
+
+int main(void)
+{
+	char *ptr, *view;
+	int fd, status;
+	pid_t pid;
+
+	ptr = os_malloc_shareable(BLOCK_SIZE, &fd);
+	FAIL(ptr == NULL || fd < 0, "DBG: os_malloc_shareable failed");
+	memset(ptr, 1, BLOCK_SIZE);
+
+	/* Another process maps the descriptor and sees the same pages */
+	pid = fork();
+	FAIL(pid < 0, "DBG: fork failed");
+	if (pid == 0) {
+		view = mmap(NULL, BLOCK_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, OSMEM_SHAREABLE_OFFSET);
+		FAIL(view == MAP_FAILED, "DBG: mapping the shareable block failed");
+		FAIL(view[0] != 1 || view[BLOCK_SIZE - 1] != 1, "DBG: shareable block not shared");
+		memset(view, 2, BLOCK_SIZE);
+		exit(0);
+	}
+	FAIL(waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0,
+		 "DBG: child failed");
+	FAIL(ptr[0] != 2 || ptr[BLOCK_SIZE - 1] != 2, "DBG: writes of the other process not seen");
+
+	/* Growing keeps the block in the file */
+	ptr = os_realloc(ptr, 4 * BLOCK_SIZE);
+	FAIL(ptr == NULL || ptr[BLOCK_SIZE - 1] != 2, "DBG: os_realloc lost the data");
+	memset(ptr, 3, 4 * BLOCK_SIZE);
+	view = mmap(NULL, 4 * BLOCK_SIZE, PROT_READ, MAP_SHARED, fd, OSMEM_SHAREABLE_OFFSET);
+	FAIL(view == MAP_FAILED || view[4 * BLOCK_SIZE - 1] != 3, "DBG: grown block not in the file");
+
+	/* os_free closes the descriptor, other mappings stay */
+	os_free(ptr);
+	FAIL(fcntl(fd, F_GETFD) != -1, "DBG: os_free did not close the descriptor");
+	FAIL(view[0] != 3, "DBG: other mapping lost after os_free");
+	munmap(view, 4 * BLOCK_SIZE);
+
+	return 0;
+}
@@ -0,0 +1,66 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <sys/wait.h>
+#include "test-utils.h"
+
+#define HEAP_SIZE	(64 * MULT_KB)
+
+struct message {
+	size_t text;
+	int value;
+};
+
+int main(void)
+{
+	os_shm_heap *heap, *child_heap;
+	struct message *msg;
+	char *text;
+	int fd, status;
+	pid_t pid;
+
+	heap = os_shm_create(HEAP_SIZE, &fd);
+	FAIL(heap == NULL, "DBG: os_shm_create returned NULL");
+
+	/* The child allocates in its own mapping, linked by offset */
+	pid = fork();
+	FAIL(pid < 0, "DBG: fork failed");
+	if (pid == 0) {
+		child_heap = os_shm_attach(fd);
+		FAIL(child_heap == NULL, "DBG: os_shm_attach returned NULL");
+		msg = os_shm_malloc(child_heap, sizeof(*msg));
+		text = os_shm_malloc(child_heap, 32);
+		FAIL(msg == NULL || text == NULL, "DBG: os_shm_malloc returned NULL on valid size");
+		strcpy(text, "from the child");
+		msg->text = os_shm_offset(child_heap, text);
+		msg->value = 42;
+		os_shm_set_root(child_heap, msg);
+		os_shm_detach(child_heap);
+		exit(0);
+	}
+	FAIL(waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0,
+		 "DBG: child failed");
+
+	/* The parent finds the blocks from the root and frees them */
+	msg = os_shm_root(heap);
+	FAIL(msg == NULL || msg->value != 42, "DBG: root not shared between processes");
+	text = os_shm_ptr(heap, msg->text);
+	FAIL(strcmp(text, "from the child") != 0, "DBG: block not shared between processes");
+	os_shm_set_root(heap, NULL);
+	os_shm_free(heap, text);
+	os_shm_free(heap, msg);
+
+	/* The heap does not grow, and its space comes back once freed */
+	errno = 0;
+	FAIL(os_shm_malloc(heap, 2 * HEAP_SIZE) != NULL || errno != ENOMEM, "DBG: os_shm_malloc went past the heap");
+	text = os_shm_malloc(heap, HEAP_SIZE / 2);
+	FAIL(text == NULL, "DBG: freed space not reused");
+	os_shm_free(heap, text);
+
+	/* Only a heap can be attached */
+	FAIL(os_shm_attach(open("/dev/null", O_RDONLY)) != NULL, "DBG: os_shm_attach accepted an empty file");
+
+	os_shm_detach(heap);
+	close(fd);
+
+	return 0;
+}
@@ -0,0 +1,87 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "test-utils.h"
+
+#define NUM_NODES	100
+
+struct node {
+	struct node *next;
+	int value;
+	char payload[200];
+};
+
+/* Runs in a fresh process: map the heap back and walk the list */
+static int restore(const char *path, const char *head_addr)
+{
+	struct node *head = (struct node *)strtoul(head_addr, NULL, 16);
+	int count = 0;
+	struct stat st;
+	void *ptr;
+
+	/* A file whose size does not match its header is refused */
+	FAIL(stat(path, &st) != 0, "DBG: stat failed");
+	FAIL(truncate(path, st.st_size + 1) != 0, "DBG: truncate failed");
+	errno = 0;
+	FAIL(os_heap_restore(path) != -1 || errno != EINVAL, "DBG: os_heap_restore took a resized file");
+	FAIL(truncate(path, st.st_size) != 0, "DBG: truncate failed");
+
+	FAIL(os_heap_restore(path) != 0, "DBG: os_heap_restore failed");
+	for (struct node *node = head; node; node = node->next, count++)
+		FAIL(node->value != count || node->payload[199] != (char)count, "DBG: restored node corrupted");
+	FAIL(count != NUM_NODES, "DBG: restored list has the wrong length");
+
+	/* The restored heap keeps working, blocks are freed and reused */
+	os_free(head->next);
+	ptr = os_malloc_checked(sizeof(struct node));
+	FAIL(ptr != head->next, "DBG: restored free block not reused");
+	ptr = os_malloc_checked(4 * MMAP_THRESHOLD / 5);
+	memset(ptr, 1, 4 * MMAP_THRESHOLD / 5);
+	os_free(ptr);
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	char path[] = "/tmp/osmem-snapshot-XXXXXX", addr[32];
+	struct node *head = NULL, **tail = &head;
+	int fd, status;
+	pid_t pid;
+
+	if (argc == 3)
+		return restore(argv[1], argv[2]);
+
+	fd = mkstemp(path);
+	FAIL(fd < 0, "DBG: mkstemp failed");
+	close(fd);
+
+	for (int i = 0; i < NUM_NODES; i++) {
+		*tail = os_malloc_checked(sizeof(struct node));
+		(*tail)->value = i;
+		(*tail)->next = NULL;
+		memset((*tail)->payload, i, sizeof((*tail)->payload));
+		tail = &(*tail)->next;
+		os_free(os_malloc_checked(50));
+	}
+	FAIL(os_heap_snapshot(path) != 0, "DBG: os_heap_snapshot failed");
+
+	/* A used heap cannot be replaced */
+	errno = 0;
+	FAIL(os_heap_restore(path) != -1 || errno != EBUSY, "DBG: os_heap_restore replaced a used heap");
+
+	snprintf(addr, sizeof(addr), "%lx", (unsigned long)head);
+	pid = fork();
+	FAIL(pid < 0, "DBG: fork failed");
+	if (pid == 0) {
+		execl("/proc/self/exe", argv[0], path, addr, NULL);
+		exit(1);
+	}
+	FAIL(waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0,
+		 "DBG: restoring process failed");
+
+	unlink(path);
+
+	return 0;
+}
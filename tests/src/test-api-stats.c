@@ -0,0 +1,34 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "test-utils.h"
+
+int main(void)
+{
+	os_mem_stats stats, loop;
+	void *ptr;
+
+	/* The preallocated heap is one free block */
+	ptr = os_malloc_checked(100);
+	os_stats(&stats);
+	FAIL(stats.heap_blocks != 1 || stats.heap_bytes < 100, "DBG: os_stats missed a block in use");
+	FAIL(stats.heap_bytes + stats.heap_free_bytes != MMAP_THRESHOLD, "DBG: os_stats does not cover the heap");
+	os_free(ptr);
+
+	/* A malloc/free loop reuses its block instead of growing the heap */
+	for (int i = 0; i < 2000; i++) {
+		ptr = os_malloc_checked(60000);
+		memset(ptr, i, 60000);
+		os_free(ptr);
+	}
+	os_stats(&loop);
+	FAIL(loop.heap_blocks != 0, "DBG: freed blocks counted as in use");
+	FAIL(loop.heap_bytes + loop.heap_free_bytes != MMAP_THRESHOLD, "DBG: malloc/free loop grew the heap");
+
+	/* Mapped blocks are not part of the heap */
+	ptr = os_malloc_checked(2 * MMAP_THRESHOLD);
+	os_stats(&stats);
+	FAIL(stats.heap_blocks != 0, "DBG: mapped block counted on the heap");
+	os_free(ptr);
+
+	return 0;
+}
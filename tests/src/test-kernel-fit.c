@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "test-utils.h"
+
+#define MAX_COUNT	300
+#define NUM_ROUNDS	2000
+#define NUM_STATUS	10
+
+/* Exported by the library, declared in src/helpers.h */
+size_t fit_scan(const size_t *size, const unsigned char *status, size_t count, size_t req);
+size_t fit_scan_generic(const size_t *size, const unsigned char *status, size_t count, size_t req);
+
+/* Few distinct sizes, so that ties between lanes are common */
+static size_t pool[] = {32, 64, 96, 4096, 4128, 131072, 1UL << 40};
+
+#define POOL_SIZE	(sizeof(pool) / sizeof(pool[0]))
+
+/* The first free entry with the smallest size that fits, like the list walk */
+static size_t best_fit(const size_t *size, const unsigned char *status, size_t count, size_t req)
+{
+	size_t best = count;
+
+	for (size_t i = 0; i < count; i++)
+		if (status[i] == STATUS_FREE && size[i] >= req && (best == count || size[i] < size[best]))
+			best = i;
+	return best;
+}
+
+static void check(const size_t *size, const unsigned char *status, size_t count, size_t req)
+{
+	size_t expected = best_fit(size, status, count, req);
+
+	FAIL(fit_scan_generic(size, status, count, req) != expected, "DBG: scalar fit_scan picked the wrong entry");
+	FAIL(fit_scan(size, status, count, req) != expected, "DBG: fit_scan picked the wrong entry");
+}
+
+int main(void)
+{
+	size_t size[MAX_COUNT];
+	unsigned char status[MAX_COUNT];
+
+	srand(42);
+	for (int round = 0; round < NUM_ROUNDS; round++) {
+		/* Every length up to a few vectors, so each kernel runs its tail too */
+		size_t count = round < 100 ? round % 40 : rand() % MAX_COUNT;
+		int free_pct = round % 2 ? 30 : 90;
+
+		for (size_t i = 0; i < count; i++) {
+			size[i] = pool[rand() % POOL_SIZE] + (round % 3 ? 0 : rand() % 3 * 8);
+			status[i] = rand() % 100 < free_pct ? STATUS_FREE : 1 + rand() % (NUM_STATUS - 1);
+		}
+
+		check(size, status, count, 0);
+		check(size, status, count, (1UL << 40) + 1);
+		for (size_t p = 0; p < POOL_SIZE; p++) {
+			check(size, status, count, pool[p]);
+			check(size, status, count, pool[p] + 1);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,82 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "test-utils.h"
+
+/* Copies and clears from this size on take the non-temporal path */
+#ifndef MEM_NT_THRESHOLD
+#define MEM_NT_THRESHOLD	(1024 * 1024)
+#endif
+
+#define GUARD			64
+
+/* Room for n bytes at any offset, with guard bytes on both sides */
+#define SPAN(n)			((n) + 2 * GUARD + 64)
+
+/* Exported by the library, declared in src/helpers.h */
+void mem_copy(void *dst, const void *src, size_t n);
+void mem_zero(void *dst, size_t n);
+
+static size_t sizes[] = {
+	0, 1, 15, 16, 17, 63, 64, 65, 255, 4097,
+	MEM_NT_THRESHOLD - 1, MEM_NT_THRESHOLD, MEM_NT_THRESHOLD + 1,
+	MEM_NT_THRESHOLD + 63, MEM_NT_THRESHOLD + 255, 3 * MEM_NT_THRESHOLD + 129
+};
+
+/* Misalign the start, and with it the tail, against every vector width */
+static size_t offsets[] = {0, 1, 7, 15, 16, 31, 33, 63};
+
+#define NUM_SIZES	(sizeof(sizes) / sizeof(sizes[0]))
+#define NUM_OFFSETS	(sizeof(offsets) / sizeof(offsets[0]))
+#define BUF_SIZE	SPAN(3 * MEM_NT_THRESHOLD + 129)
+
+static unsigned char *src, *dst, *ref;
+
+static void fill(unsigned char *buf, size_t len, unsigned int seed)
+{
+	for (size_t i = 0; i < len; i++)
+		buf[i] = (unsigned char)(i * 131 + seed + (i >> 12));
+}
+
+static void check_copy(size_t n, size_t dst_off, size_t src_off)
+{
+	fill(src, SPAN(n), 1);
+	fill(dst, SPAN(n), 2);
+	memcpy(ref, dst, SPAN(n));
+
+	mem_copy(dst + GUARD + dst_off, src + GUARD + src_off, n);
+	memcpy(ref + GUARD + dst_off, src + GUARD + src_off, n);
+	FAIL(memcmp(dst, ref, SPAN(n)), "DBG: mem_copy differs from memcpy");
+}
+
+static void check_zero(size_t n, size_t dst_off)
+{
+	fill(dst, SPAN(n), 3);
+	memcpy(ref, dst, SPAN(n));
+
+	mem_zero(dst + GUARD + dst_off, n);
+	memset(ref + GUARD + dst_off, 0, n);
+	FAIL(memcmp(dst, ref, SPAN(n)), "DBG: mem_zero differs from memset");
+}
+
+int main(void)
+{
+	src = malloc(BUF_SIZE);
+	dst = malloc(BUF_SIZE);
+	ref = malloc(BUF_SIZE);
+	FAIL(!src || !dst || !ref, "DBG: malloc failed");
+
+	/* The guards are compared too, so bytes written past either end show up */
+	for (size_t i = 0; i < NUM_SIZES; i++) {
+		for (size_t d = 0; d < NUM_OFFSETS; d++) {
+			check_zero(sizes[i], offsets[d]);
+			for (size_t s = 0; s < NUM_OFFSETS; s++)
+				check_copy(sizes[i], offsets[d], offsets[s]);
+		}
+	}
+
+	free(ref);
+	free(dst);
+	free(src);
+
+	return 0;
+}
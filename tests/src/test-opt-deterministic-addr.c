@@ -0,0 +1,43 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "test-utils.h"
+
+/* Same defaults as src/helpers.h */
+#ifndef DETERMINISTIC_HEAP_BASE
+#define DETERMINISTIC_HEAP_BASE	0x100000000000UL
+#endif
+#ifndef DETERMINISTIC_MAP_BASE
+#define DETERMINISTIC_MAP_BASE	0x200000000000UL
+#endif
+
+#define MAP_SIZE	(2 * MMAP_THRESHOLD)
+
+int main(void)
+{
+	size_t page_size = getpagesize();
+	size_t mapped = (MAP_SIZE + METADATA_SIZE + page_size - 1) & ~(page_size - 1);
+	void *brk_start = sbrk(0);
+	char *heap, *first, *second;
+
+	/* The heap starts at its fixed base instead of the program break */
+	heap = os_malloc_checked(100);
+	FAIL(heap != (char *)DETERMINISTIC_HEAP_BASE + METADATA_SIZE, "DBG: heap is not at its fixed base");
+	FAIL(sbrk(0) != brk_start, "DBG: heap moved the program break");
+
+	/* Mappings follow each other from their base, with a guard page between them */
+	first = os_malloc_checked(MAP_SIZE);
+	FAIL(first != (char *)DETERMINISTIC_MAP_BASE + METADATA_SIZE, "DBG: first mapping is not at the map base");
+	second = os_malloc_checked(MAP_SIZE);
+	FAIL(second != first + mapped + page_size, "DBG: second mapping is not after the first");
+
+	/* A freed range is not handed out again */
+	os_free(first);
+	first = os_malloc_checked(MAP_SIZE);
+	FAIL(first != second + mapped + page_size, "DBG: a mapping was placed twice at the same address");
+
+	os_free(first);
+	os_free(second);
+	os_free(heap);
+
+	return 0;
+}
@@ -0,0 +1,55 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "test-utils.h"
+
+#define SMALL_SIZE	300
+#define BIG_SIZE	5000
+
+/* The allocator must not look at the header of a free block any more */
+static void scribble(char *ptr)
+{
+	memset(ptr - METADATA_SIZE, 0xff, METADATA_SIZE);
+}
+
+int main(void)
+{
+	char *a, *b, *c, *d, *e, *ptr;
+	os_mem_stats stats;
+
+	a = os_malloc_checked(SMALL_SIZE);
+	b = os_malloc_checked(BIG_SIZE);
+	c = os_malloc_checked(SMALL_SIZE);
+	d = os_malloc_checked(BIG_SIZE);
+	e = os_malloc_checked(SMALL_SIZE);
+
+	os_free(b);
+	os_free(d);
+	scribble(b);
+	scribble(d);
+
+	/* Stats come from the table */
+	os_stats(&stats);
+	FAIL(stats.heap_blocks != 3, "DBG: os_stats miscounted the blocks in use");
+	FAIL(stats.heap_bytes + stats.heap_free_bytes != MMAP_THRESHOLD, "DBG: os_stats does not cover the heap");
+
+	/* Best fit breaks ties on the lowest address, like the list */
+	ptr = os_malloc_checked(BIG_SIZE);
+	FAIL(ptr != b, "DBG: best fit did not pick the first of two equal blocks");
+	memset(ptr, 1, BIG_SIZE);
+
+	/* Freed neighbours are merged without reading their headers */
+	os_free(c);
+	scribble(c);
+	ptr = os_malloc_checked(BIG_SIZE + SMALL_SIZE);
+	FAIL(ptr != c, "DBG: free neighbours were not merged");
+	memset(ptr, 2, BIG_SIZE + SMALL_SIZE);
+
+	os_free(ptr);
+	os_free(b);
+	os_free(e);
+	os_free(a);
+	os_stats(&stats);
+	FAIL(stats.heap_blocks != 0, "DBG: freed blocks counted as in use");
+
+	return 0;
+}
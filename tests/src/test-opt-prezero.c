@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <stdint.h>
+#include <sys/wait.h>
+#include "test-utils.h"
+
+#define BLOCK_SIZE	(64 * MULT_KB)
+#define NUM_WAITS	100
+#define NUM_ROUNDS	2000
+
+/* Number of pages of [ptr, ptr + len) that are backed by memory */
+static size_t resident(void *ptr, size_t len)
+{
+	size_t page_size = getpagesize(), count = 0;
+	uintptr_t start = ((uintptr_t)ptr + page_size - 1) & ~(page_size - 1);
+	size_t pages = ((uintptr_t)ptr + len - start) / page_size;
+	unsigned char *vec = malloc(pages);
+
+	FAIL(vec == NULL || mincore((void *)start, pages * page_size, vec) != 0, "DBG: mincore failed");
+	for (size_t i = 0; i < pages; i++)
+		count += vec[i] & 1;
+	free(vec);
+	return count;
+}
+
+/* Give the thread time to clear the queue, the next allocation collects it */
+static void wait_zeroed(void)
+{
+	for (int i = 0; i < NUM_WAITS; i++) {
+		usleep(10000);
+		os_free(os_malloc_checked(8));
+	}
+}
+
+static void check_zero(char *ptr, size_t size)
+{
+	for (size_t i = 0; i < size; i++)
+		FAIL(ptr[i] != 0, "DBG: os_calloc returned memory that is not zero");
+}
+
+int main(void)
+{
+	os_mem_stats start, loop;
+	char *block, *blocker, *ptr;
+	int status;
+	pid_t pid;
+
+	/* A big freed block is cleared in the background by dropping its pages */
+	block = os_malloc_checked(BLOCK_SIZE);
+	memset(block, 1, BLOCK_SIZE);
+	blocker = os_malloc_checked(100);
+	os_free(block);
+	wait_zeroed();
+
+	/* os_calloc hands it out without touching it again. Reading its pages
+	would map them too, so residency is checked first */
+	ptr = os_calloc(1, BLOCK_SIZE);
+	FAIL(ptr != block, "DBG: zeroed block not reused");
+	FAIL(resident(ptr, BLOCK_SIZE) != 0, "DBG: os_calloc cleared a zeroed block again");
+	check_zero(ptr, BLOCK_SIZE);
+	os_free(ptr);
+
+	/* A malloc/free loop takes its block back instead of growing the heap */
+	os_stats(&start);
+	for (int i = 0; i < NUM_ROUNDS; i++) {
+		ptr = os_malloc_checked(BLOCK_SIZE);
+		memset(ptr, i, BLOCK_SIZE);
+		os_free(ptr);
+	}
+	os_stats(&loop);
+	FAIL(loop.heap_bytes + loop.heap_free_bytes != start.heap_bytes + start.heap_free_bytes,
+		 "DBG: malloc/free loop grew the heap");
+
+	/* A forked child gets the queued blocks back and starts its own thread */
+	ptr = os_malloc_checked(BLOCK_SIZE);
+	memset(ptr, 2, BLOCK_SIZE);
+	os_free(ptr);
+	pid = fork();
+	FAIL(pid < 0, "DBG: fork failed");
+	if (pid == 0) {
+		ptr = os_calloc_checked(1, BLOCK_SIZE);
+		check_zero(ptr, BLOCK_SIZE);
+		memset(ptr, 3, BLOCK_SIZE);
+		os_free(ptr);
+		wait_zeroed();
+		ptr = os_calloc(1, BLOCK_SIZE);
+		FAIL(ptr == NULL || resident(ptr, BLOCK_SIZE) != 0, "DBG: no zeroing thread in the child");
+		check_zero(ptr, BLOCK_SIZE);
+		exit(0);
+	}
+	FAIL(waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0,
+		 "DBG: forked child failed");
+
+	os_free(blocker);
+
+	return 0;
+}
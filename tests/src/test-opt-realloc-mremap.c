@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include <stdint.h>
+#include "test-utils.h"
+
+#define BIG_SIZE	(4 * MULT_KB * MULT_KB)
+#define HEAP_SIZE	(50 * MULT_KB)
+
+/* Number of pages of [ptr, ptr + len) that are backed by memory */
+static size_t resident(void *ptr, size_t len)
+{
+	size_t page_size = getpagesize(), count = 0;
+	uintptr_t start = (uintptr_t)ptr & ~(page_size - 1);
+	size_t pages = ((uintptr_t)ptr + len - start + page_size - 1) / page_size;
+	unsigned char *vec = malloc(pages);
+
+	FAIL(vec == NULL || mincore((void *)start, pages * page_size, vec) != 0, "DBG: mincore failed");
+	for (size_t i = 0; i < pages; i++)
+		count += vec[i] & 1;
+	free(vec);
+	return count;
+}
+
+int main(void)
+{
+	size_t page_size = getpagesize();
+	uintptr_t start;
+	char *big, *small, *block, *blocker, *moved;
+
+	/* A mapped block grows without touching the pages in the middle */
+	big = os_malloc_checked(BIG_SIZE);
+	/* Huge pages would fault in the middle too. The whole mapping takes the
+	advice, a split mapping could not be remapped */
+	start = (uintptr_t)big & ~(page_size - 1);
+	madvise((void *)start, (uintptr_t)big + BIG_SIZE - start, MADV_NOHUGEPAGE);
+	big[0] = 1;
+	big[BIG_SIZE - 1] = 2;
+	big = os_realloc(big, 2 * BIG_SIZE);
+	FAIL(big == NULL, "DBG: os_realloc of a mapped block failed");
+	FAIL(big[0] != 1 || big[BIG_SIZE - 1] != 2, "DBG: growing a mapped block lost the data");
+	FAIL(resident(big + page_size, BIG_SIZE - 2 * page_size) != 0,
+		 "DBG: growing a mapped block copied it");
+
+	/* And shrinks in place while it stays above the threshold */
+	big = os_realloc(big, MMAP_THRESHOLD + 1);
+	FAIL(big == NULL || big[0] != 1, "DBG: shrinking a mapped block lost the data");
+	os_free(big);
+
+	/* A heap block that cannot expand moves its pages to a mapping */
+	small = os_malloc_checked(100);
+	block = os_malloc_checked(HEAP_SIZE);
+	blocker = os_malloc_checked(100);
+	memset(block, 3, HEAP_SIZE);
+	moved = os_realloc(block, 4 * MMAP_THRESHOLD);
+	FAIL(moved == NULL, "DBG: os_realloc of a heap block failed");
+	FAIL(((uintptr_t)moved & (page_size - 1)) != ((uintptr_t)block & (page_size - 1)),
+		 "DBG: promoted block changed its offset inside the page");
+	for (size_t i = 0; i < HEAP_SIZE; i++)
+		FAIL(moved[i] != 3, "DBG: promoting a heap block lost the data");
+
+	/* The old heap block is free again */
+	FAIL(os_malloc_checked(HEAP_SIZE) != block, "DBG: promoted heap block not reused");
+
+	os_free(moved);
+	os_free(blocker);
+	os_free(small);
+
+	return 0;
+}
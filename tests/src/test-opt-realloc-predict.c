@@ -0,0 +1,44 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "test-utils.h"
+
+#define START_SIZE	1000
+#define STEP		100
+#define STREAK		4
+
+int main(void)
+{
+	char *ptr, *grown;
+	size_t usable;
+
+	/* The first reallocs in a row get what they ask for */
+	ptr = os_malloc_checked(START_SIZE);
+	memset(ptr, 1, START_SIZE);
+	for (int i = 1; i < STREAK; i++) {
+		ptr = os_realloc(ptr, START_SIZE + i * STEP);
+		FAIL(ptr == NULL, "DBG: os_realloc failed");
+		FAIL(os_malloc_usable_size(ptr) >= 2 * START_SIZE, "DBG: block over-provisioned before the streak");
+	}
+
+	/* The next one at least doubles the block */
+	usable = os_malloc_usable_size(ptr);
+	ptr = os_realloc(ptr, usable + 1);
+	FAIL(ptr == NULL, "DBG: os_realloc failed");
+	FAIL(os_malloc_usable_size(ptr) < 2 * usable, "DBG: growing block was not doubled");
+	for (int i = 0; i < START_SIZE; i++)
+		FAIL(ptr[i] != 1, "DBG: growing lost the data");
+
+	/* Later reallocs fit in the slack, smaller ones keep it */
+	usable = os_malloc_usable_size(ptr);
+	grown = os_realloc(ptr, usable);
+	FAIL(grown != ptr, "DBG: realloc inside the slack moved the block");
+	grown = os_realloc(ptr, usable / 2);
+	FAIL(grown != ptr || os_malloc_usable_size(ptr) != usable, "DBG: shrinking a growing block dropped its slack");
+
+	/* Below a quarter the streak ends and the block is cut down */
+	grown = os_realloc(ptr, usable / 8);
+	FAIL(grown != ptr || os_malloc_usable_size(ptr) >= usable / 4, "DBG: shrunk block kept its slack");
+	os_free(ptr);
+
+	return 0;
+}
@@ -96,11 +96,18 @@ void *os_realloc_checked(void *ptr, size_t size)
 	}
 
 	if (oldBlock.status == STATUS_ALLOC)
-		FAIL(memcmp(ptr_realloc, ptr, MIN(oldBlock.size, size)) != 0, "DBG: os_realloc corrupted memory");
+		FAIL(memcmp(ptr_realloc, ptr, MIN(oldBlock.size - METADATA_SIZE, size)) != 0, "DBG: os_realloc corrupted memory");
 
 	return ptr_realloc;
 }
 
+int page_mapped(void *ptr)
+{
+	void *page = (void *)((unsigned long)ptr & ~((unsigned long)getpagesize() - 1));
+
+	return msync(page, getpagesize(), MS_ASYNC) == 0;
+}
+
 void *mock_preallocate(void)
 {
 	return os_malloc(MOCK_PREALLOC);